@@ -300,4 +300,81 @@ void benchmark(long repetitions, std::vector<long> number_of_parties_list, long
                 << time_network_2 << "," 
                 << time_network_3 << "\n";
     }
+}
+
+void benchmark_tree_aggregation(long repetitions, std::vector<long> number_of_parties_list, long set_size_clients, long set_size_server, 
+                                int false_positive_exponent, std::vector<int> fan_outs) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream tree_csv("../data/tree_aggregation.csv");
+    tree_csv << "Parties,Fan-out,Client Online,Judge,Client Sent,Client Received,Judge Received\n";
+
+    for (long t : number_of_parties_list) {
+        BloomFilterParams params(set_size_clients, false_positive_exponent); 
+        Keys keys;
+        key_gen(&keys, 1024, t, t); 
+
+        // fan-out 0 is the direct topology, every client sends its ERBF to the judge
+        for (int fan_out : fan_outs) {
+            std::cout << "\nBenchmarking " << t << " parties, fan-out " << fan_out << std::endl;
+
+            std::vector<long> client_online_times, judge_computation_times;
+            std::vector<size_t> client_sent_bytes_all, client_received_bytes_all, judge_received_bytes_all;
+            for (int i = 0; i < repetitions; ++i) {
+                std::vector<std::vector<long>> client_sets;
+                std::vector<long> server_set;
+                generate_clients_and_server_sets(t - 1, set_size_clients, set_size_server, 
+                    domain_size, forced_intersection_size, client_sets, server_set);
+
+                double client_prep_time = 0.0;
+                double client_online_time = 0.0;
+                double server_computation_time = 0.0;
+                double judge_computation_time = 0.0;
+                size_t server_sent_bytes = 0;
+                size_t server_received_bytes = 0;
+                size_t client_sent_bytes = 0;
+                size_t client_received_bytes = 0;
+                size_t judge_sent_bytes = 0;
+                size_t judge_received_bytes = 0;
+
+                std::vector<long> result = multiparty_psi(
+                    client_sets, 
+                    server_set, 
+                    params, 
+                    keys,
+                    &client_prep_time,
+                    &client_online_time,
+                    &server_computation_time,
+                    &judge_computation_time,
+                    &server_sent_bytes,
+                    &server_received_bytes,
+                    &client_sent_bytes,
+                    &client_received_bytes,
+                    &judge_sent_bytes,
+                    &judge_received_bytes,
+                    fan_out
+                );
+
+                std::vector<long> expected = compute_intersection_non_private(client_sets, server_set);
+                std::cout << "Expected size: " << expected.size() << ", MPSI size: " << result.size();
+                std::cout << ", Judge: " << judge_computation_time << " ms, " << judge_received_bytes << " bytes received" << std::endl;
+
+                client_online_times.push_back(static_cast<long>(client_online_time));
+                judge_computation_times.push_back(static_cast<long>(judge_computation_time));
+                client_sent_bytes_all.push_back(client_sent_bytes);
+                client_received_bytes_all.push_back(client_received_bytes);
+                judge_received_bytes_all.push_back(judge_received_bytes);
+            }
+
+            tree_csv << t << "," 
+                    << fan_out << ","
+                    << sample_mean_computation(client_online_times) << ","
+                    << sample_mean_computation(judge_computation_times) << ","
+                    << sample_mean_communication(client_sent_bytes_all) << ","
+                    << sample_mean_communication(client_received_bytes_all) << ","
+                    << sample_mean_communication(judge_received_bytes_all) << "\n";
+        }
+    }
 }
\ No newline at end of file
@@ -11,4 +11,13 @@ void benchmark(
     int false_positive_exponent
 );
 
+void benchmark_tree_aggregation(
+    long repetitions, 
+    std::vector<long> parties_list, 
+    long set_size_clients, 
+    long set_size_server,
+    int false_positive_exponent,
+    std::vector<int> fan_outs
+);
+
 #endif
\ No newline at end of file
@@ -34,5 +34,7 @@ int main() {
 
     benchmark(10, {2, 3, 5, 10, 20, 30, 40, 50, 100}, 256, 1024, -7);
 
+    benchmark_tree_aggregation(10, {10, 50, 100}, 256, 1024, -7, {0, 2, 4, 8, 16});
+
     return 0;
 }
\ No newline at end of file
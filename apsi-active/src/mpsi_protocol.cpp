@@ -1,5 +1,6 @@
 #include "mpsi_protocol.hpp"
 #include <chrono>
+#include <algorithm>
 
 size_t get_ciphertext_size(const Ciphertext& ct) {
     return NumBytes(ct.c1) + NumBytes(ct.c2);
@@ -43,6 +44,40 @@ std::vector<Ciphertext> aggegate_ciphertexts(const std::vector<long>& server_set
     return combined_ciphertexts;
 }
 
+std::vector<Ciphertext> tree_aggregate_erbfs(
+    const std::vector<std::vector<Ciphertext>>& erbfs,
+    int fan_out,
+    const Keys& keys,
+    double* critical_path_time,
+    size_t* total_sent_bytes
+) {
+    using namespace std::chrono;
+    // Every group of fan_out nodes sends its ERBFs to the first node of the group
+    std::vector<std::vector<Ciphertext>> level = erbfs;
+    while (level.size() > 1) {
+        std::vector<std::vector<Ciphertext>> next_level;
+        double slowest_group = 0.0;
+        for (size_t leader = 0; leader < level.size(); leader += fan_out) {
+            auto start = high_resolution_clock::now();
+            std::vector<Ciphertext> aggregated = level[leader];
+            for (size_t child = leader + 1; child < std::min(leader + fan_out, level.size()); child++) {
+                for (size_t l = 0; l < aggregated.size(); l++) {
+                    aggregated[l].c1 = MulMod(aggregated[l].c1, level[child][l].c1, keys.params.p);
+                    aggregated[l].c2 = MulMod(aggregated[l].c2, level[child][l].c2, keys.params.p);
+                }
+                for (const auto& ct : level[child]) 
+                    *total_sent_bytes += get_ciphertext_size(ct);
+            }
+            auto stop = high_resolution_clock::now();
+            slowest_group = std::max(slowest_group, duration<double, std::milli>(stop - start).count());
+            next_level.push_back(std::move(aggregated));
+        }
+        *critical_path_time += slowest_group;
+        level = std::move(next_level);
+    }
+    return level[0];
+}
+
 std::vector<long> decrypt_intersection(const std::vector<Ciphertext>& combined_ciphertexts, 
                                     const std::vector<long>& server_set, 
                                     const Keys& keys) {
@@ -70,7 +105,8 @@ std::vector<long> multiparty_psi(
     size_t* client_sent_bytes,
     size_t* client_received_bytes,
     size_t* judge_sent_bytes,
-    size_t* judge_received_bytes
+    size_t* judge_received_bytes,
+    int fan_out
 ) {
     using namespace std::chrono;
     int n_clients = client_sets.size();
@@ -89,19 +125,39 @@ std::vector<long> multiparty_psi(
     *server_sent_bytes += server_set.size() * sizeof(long);
     *judge_received_bytes += server_set.size() * sizeof(long);
 
-    // Clients send their ERBFs to the Judge
-    size_t total_erbf_size_bytes = 0;
-    for (const auto& erbfs : all_erbfs) 
-        for (const auto& ct : erbfs) 
-            total_erbf_size_bytes += get_ciphertext_size(ct);
-    *client_sent_bytes += total_erbf_size_bytes / n_clients; 
-    *judge_received_bytes += total_erbf_size_bytes;
+    std::vector<Ciphertext> combined_ciphertexts;
+    if (fan_out > 1) {
+        // Clients multiply their ERBFs up the tree, the root sends one ERBF to the Judge
+        size_t tree_sent_bytes = 0;
+        std::vector<Ciphertext> aggregated_erbf = tree_aggregate_erbfs(all_erbfs, fan_out, keys, 
+                                                                       client_online_time, &tree_sent_bytes);
+        size_t aggregated_erbf_size_bytes = 0;
+        for (const auto& ct : aggregated_erbf) 
+            aggregated_erbf_size_bytes += get_ciphertext_size(ct);
+        *client_sent_bytes += (tree_sent_bytes + aggregated_erbf_size_bytes) / n_clients;
+        *client_received_bytes += tree_sent_bytes / n_clients;
+        *judge_received_bytes += aggregated_erbf_size_bytes;
 
-    // Judge selects the bins corresponding to the server's elements and aggregates the ciphertexts
-    auto judge_aggregation_start = high_resolution_clock::now();
-    std::vector<Ciphertext> combined_ciphertexts = aggegate_ciphertexts(server_set, all_erbfs, n_clients, bf_params, keys);
-    auto judge_aggregation_stop = high_resolution_clock::now();
-    *judge_computation_time += duration<double, std::milli>(judge_aggregation_stop - judge_aggregation_start).count();
+        // Judge needs only k multiplications per server element
+        auto judge_aggregation_start = high_resolution_clock::now();
+        combined_ciphertexts = aggegate_ciphertexts(server_set, {aggregated_erbf}, 1, bf_params, keys);
+        auto judge_aggregation_stop = high_resolution_clock::now();
+        *judge_computation_time += duration<double, std::milli>(judge_aggregation_stop - judge_aggregation_start).count();
+    } else {
+        // Clients send their ERBFs to the Judge
+        size_t total_erbf_size_bytes = 0;
+        for (const auto& erbfs : all_erbfs) 
+            for (const auto& ct : erbfs) 
+                total_erbf_size_bytes += get_ciphertext_size(ct);
+        *client_sent_bytes += total_erbf_size_bytes / n_clients; 
+        *judge_received_bytes += total_erbf_size_bytes;
+
+        // Judge selects the bins corresponding to the server's elements and aggregates the ciphertexts
+        auto judge_aggregation_start = high_resolution_clock::now();
+        combined_ciphertexts = aggegate_ciphertexts(server_set, all_erbfs, n_clients, bf_params, keys);
+        auto judge_aggregation_stop = high_resolution_clock::now();
+        *judge_computation_time += duration<double, std::milli>(judge_aggregation_stop - judge_aggregation_start).count();
+    }
 
     // Judge sends the aggregated ciphertexts to the server
     size_t combined_ciphertext_size_bytes = 0;
@@ -20,7 +20,19 @@ std::vector<long> multiparty_psi(
     size_t* client_sent_bytes,
     size_t* client_received_bytes,
     size_t* judge_sent_bytes,
-    size_t* judge_received_bytes
+    size_t* judge_received_bytes,
+    int fan_out = 0 // > 1: clients pre-aggregate their ERBFs in a tree, the judge receives only the root
+);
+
+// Bin-wise product of the clients' ERBFs over a tree with the given fan-out.
+// Every level's groups work in parallel, so the critical path is the sum of the
+// slowest group of each level.
+std::vector<Ciphertext> tree_aggregate_erbfs(
+    const std::vector<std::vector<Ciphertext>>& erbfs,
+    int fan_out,
+    const Keys& keys,
+    double* critical_path_time,
+    size_t* total_sent_bytes
 );
 
 #endif 
\ No newline at end of file
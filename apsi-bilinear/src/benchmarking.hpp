@@ -4,6 +4,7 @@
 #include <vector>
 #include "mpsi_protocol.hpp"
 #include "experiments.hpp"
+#include "curve.hpp"
 
 void benchmark(
     long repetitions, 
@@ -13,7 +14,29 @@ void benchmark(
     int false_positive_exponent
 );
 
-GT setup_pairings();
-void setup_judge_keys(mcl::bn::G2& judge_pk, mcl::bn::Fr& judge_sk);
+void benchmark_tree_aggregation(
+    long repetitions, 
+    std::vector<long> parties_list, 
+    long set_size_clients, 
+    long set_size_server,
+    int false_positive_exponent,
+    std::vector<int> fan_outs
+);
+
+void benchmark_gbf_construction(long repetitions, std::vector<long> set_sizes, int false_positive_exponent);
+
+void benchmark_judge_service(long rounds, std::vector<long> server_counts, long set_size_server, int resubmit_percent);
+
+void benchmark_curves(
+    long repetitions, 
+    long number_of_parties, 
+    long set_size_clients, 
+    long set_size_server,
+    int false_positive_exponent,
+    std::vector<std::string> curves
+);
+
+GT setup_pairings(PairingCurve curve = PairingCurve::BN254);
+void setup_judge_keys(mcl::bn::G2& judge_pk, mcl::bn::Fr& judge_sk, PairingCurve curve = PairingCurve::BN254);
 
 #endif
\ No newline at end of file
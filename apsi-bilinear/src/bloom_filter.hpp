@@ -9,6 +9,7 @@
 #include <cstddef> 
 #include <NTL/ZZ.h>
 #include <mcl/bn.hpp>
+#include "curve.hpp"
 
 using namespace NTL;
 using namespace mcl::bn;
@@ -19,14 +20,32 @@ struct BloomFilterParams {
     size_t bin_count;
     std::vector<uint64_t> seeds;
     mcl::bn::GT base_gt;
-    BloomFilterParams(size_t element_count, int64_t e_pow, GT base_gt);
+    PairingCurve curve; // base_gt and every GT in the filter live on this curve
+    BloomFilterParams(size_t element_count, int64_t e_pow, GT base_gt, PairingCurve curve = PairingCurve::BN254);
 };
 
+// Fixed-base table for powers of one GT element: windows[i][d] = base^(d * 2^(window_bits * i)).
+// A power then costs one GT multiplication per window instead of a full exponentiation
+// (window_bits <= 8).
+struct GTFixedBaseTable {
+    size_t window_bits;
+    std::vector<std::vector<GT>> windows;
+
+    explicit GTFixedBaseTable(const GT& base, size_t window_bits = 8);
+
+    void pow(GT& out, const Fr& exponent) const;
+};
+
+// Table for a long-lived base such as base_gt, built on first use and shared by every later
+// filter (thread-safe)
+const GTFixedBaseTable& cached_fixed_base_table(const GT& base);
+
 struct GarbledBloomFilter {
     std::vector<mcl::bn::GT> bins;  // m bins
     std::vector<bool> is_empty; // m bins
     std::vector<uint64_t> seeds; // k hash functions
     GT base_gt;
+    const GTFixedBaseTable* share_table; // powers of base_gt
 
     explicit GarbledBloomFilter(const BloomFilterParams& params);
     
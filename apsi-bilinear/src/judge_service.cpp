@@ -0,0 +1,168 @@
+#include "judge_service.hpp"
+#include <cmath>
+#include <algorithm>
+#include "mpsi_protocol.hpp"
+
+LatencyHistogram::LatencyHistogram(double bucket_ms, size_t bucket_count) 
+    : bucket_ms(bucket_ms), counts(std::max<size_t>(bucket_count, 1), 0) {}
+
+void LatencyHistogram::record(double latency_ms) {
+    size_t bucket = static_cast<size_t>(latency_ms / bucket_ms);
+    counts[std::min(bucket, counts.size() - 1)]++;
+    total++;
+}
+
+double LatencyHistogram::percentile(double percentile) const {
+    if (total == 0) 
+        return 0.0;
+    size_t rank = std::max<size_t>(static_cast<size_t>(std::ceil(percentile / 100.0 * total)), 1);
+    size_t seen = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+        seen += counts[b];
+        if (seen >= rank) 
+            return (b + 1) * bucket_ms;
+    }
+    return counts.size() * bucket_ms;
+}
+
+JudgeService::JudgeService(const Fr& judge_sk, const JudgeServiceConfig& config)
+    : judge_sk(judge_sk), config(config), 
+      latencies(config.histogram_bucket_ms, config.histogram_buckets) {
+    dispatcher = std::thread(&JudgeService::dispatcher_loop, this);
+}
+
+JudgeService::~JudgeService() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    request_available.notify_all();
+    dispatcher.join();
+}
+
+std::future<AuthorizationResult> JudgeService::submit(const std::vector<long>& server_set) {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    queue.push_back({server_set, Clock::now(), std::promise<AuthorizationResult>()});
+    std::future<AuthorizationResult> result = queue.back().result.get_future();
+    request_available.notify_one();
+    return result;
+}
+
+std::vector<G1> JudgeService::authorize(const std::vector<long>& server_set) {
+    return submit(server_set).get().signatures;
+}
+
+size_t JudgeService::purge_expired() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return evict(Clock::now());
+}
+
+size_t JudgeService::evict(Clock::time_point now) {
+    size_t evicted = 0;
+    while (!expiry_order.empty() && (expiry_order.front().first <= now || cache.size() > config.max_cached_tokens)) {
+        auto [expires, key] = expiry_order.front();
+        expiry_order.pop_front();
+        // a key signed again after its token expired has a later entry of its own
+        auto it = cache.find(key);
+        if (it != cache.end() && it->second.expires == expires) {
+            cache.erase(it);
+            evicted++;
+        }
+    }
+    return evicted;
+}
+
+JudgeServiceStats JudgeService::stats() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    size_t lookups = hits + misses;
+    return {requests, batches, hits, misses, lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups, latencies};
+}
+
+void JudgeService::dispatcher_loop() {
+    while (true) {
+        std::vector<Request> batch;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            request_available.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) 
+                return;
+            // Give other servers a short window to join the batch
+            auto window = std::chrono::duration<double, std::milli>(config.batch_window_ms);
+            request_available.wait_for(lock, window, [&] { 
+                return stopping || queue.size() >= config.max_batch_requests; 
+            });
+            while (!queue.empty() && batch.size() < std::max<size_t>(config.max_batch_requests, 1)) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+        serve_batch(batch);
+    }
+}
+
+// Answers every request from the cache where it can, signs the distinct misses of the whole
+// batch in one parallel run, then drops expired tokens and the oldest ones above the bound
+void JudgeService::serve_batch(std::vector<Request>& batch) {
+    Clock::time_point now = Clock::now();
+    auto ttl = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(config.token_ttl_ms));
+
+    std::vector<long> missing;
+    std::unordered_map<long, size_t> missing_index; // an item repeated within the batch is signed once
+    std::vector<AuthorizationResult> results(batch.size());
+    std::vector<std::vector<std::pair<size_t, size_t>>> pending(batch.size()); // (item, index into missing)
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        for (size_t r = 0; r < batch.size(); r++) {
+            const std::vector<long>& items = batch[r].items;
+            results[r].signatures.resize(items.size());
+            results[r].cache_hits = 0;
+            for (size_t j = 0; j < items.size(); j++) {
+                auto cached = cache.find(items[j]);
+                if (cached != cache.end() && cached->second.expires > now) {
+                    results[r].signatures[j] = cached->second.signature;
+                    results[r].cache_hits++;
+                    continue;
+                }
+                auto [index, inserted] = missing_index.emplace(items[j], missing.size());
+                if (inserted) 
+                    missing.push_back(items[j]);
+                else 
+                    results[r].cache_hits++;
+                pending[r].emplace_back(j, index->second);
+            }
+        }
+    }
+
+    std::vector<G1> signatures = ::authorize(missing, judge_sk); // the free function in mpsi_protocol
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        for (size_t i = 0; i < missing.size(); i++) {
+            cache[missing[i]] = {signatures[i], now + ttl};
+            expiry_order.emplace_back(now + ttl, missing[i]);
+        }
+        evict(Clock::now());
+    }
+
+    size_t batch_hits = 0;
+    size_t batch_lookups = 0;
+    std::vector<double> batch_latencies;
+    for (size_t r = 0; r < batch.size(); r++) {
+        AuthorizationResult& result = results[r];
+        for (const auto& [j, index] : pending[r]) 
+            result.signatures[j] = signatures[index];
+        result.latency_ms = std::chrono::duration<double, std::milli>(Clock::now() - batch[r].submitted).count();
+        batch_hits += result.cache_hits;
+        batch_lookups += result.signatures.size();
+        batch_latencies.push_back(result.latency_ms);
+        batch[r].result.set_value(std::move(result));
+    }
+
+    std::lock_guard<std::mutex> stats_lock(queue_mutex);
+    requests += batch.size();
+    batches++;
+    hits += batch_hits;
+    misses += batch_lookups - batch_hits;
+    for (double latency_ms : batch_latencies) 
+        latencies.record(latency_ms);
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifndef JUDGE_SERVICE_HPP
+#define JUDGE_SERVICE_HPP
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <unordered_map>
+#include <mcl/bn.hpp>
+
+using namespace mcl::bn;
+
+// Fixed-width latency histogram, the last bucket also holds everything above it
+struct LatencyHistogram {
+    double bucket_ms;
+    std::vector<size_t> counts;
+    size_t total = 0;
+
+    LatencyHistogram(double bucket_ms, size_t bucket_count);
+    void record(double latency_ms);
+    double percentile(double percentile) const; // upper edge of the bucket holding the percentile
+};
+
+struct AuthorizationResult {
+    std::vector<G1> signatures; // one per submitted item, in order
+    size_t cache_hits; // items served from the cache instead of being signed
+    double latency_ms; // from submission to completion, including batching
+};
+
+struct JudgeServiceConfig {
+    double token_ttl_ms = 10 * 60 * 1000.0; // cached signatures expire after this
+    size_t max_cached_tokens = 1 << 20; // beyond this the tokens closest to expiry are dropped
+    double batch_window_ms = 1.0; // how long a batch waits for requests from other servers
+    size_t max_batch_requests = 64;
+    double histogram_bucket_ms = 1.0;
+    size_t histogram_buckets = 10000;
+};
+
+struct JudgeServiceStats {
+    size_t requests;
+    size_t batches;
+    size_t hits;
+    size_t misses;
+    double hit_ratio;
+    LatencyHistogram latencies;
+};
+
+// Judge role kept resident: signatures H1(x||ID_S)^{sk} are cached per element until their
+// token expires, so a server resubmitting its set is served from memory. Requests that arrive
+// within one batch window, from any number of servers, are signed together in one parallel run.
+struct JudgeService {
+    JudgeService(const Fr& judge_sk, const JudgeServiceConfig& config);
+    ~JudgeService();
+    JudgeService(const JudgeService&) = delete;
+    JudgeService& operator=(const JudgeService&) = delete;
+
+    std::future<AuthorizationResult> submit(const std::vector<long>& server_set);
+    std::vector<G1> authorize(const std::vector<long>& server_set); // blocks until signed
+    size_t purge_expired(); // drops expired signatures, returns how many (also done after every batch)
+    JudgeServiceStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Request {
+        std::vector<long> items;
+        Clock::time_point submitted;
+        std::promise<AuthorizationResult> result;
+    };
+    struct Token {
+        G1 signature;
+        Clock::time_point expires;
+    };
+
+    void dispatcher_loop();
+    void serve_batch(std::vector<Request>& batch);
+    size_t evict(Clock::time_point now); // expired tokens, then the oldest above max_cached_tokens, caller holds cache_mutex
+
+    Fr judge_sk;
+    JudgeServiceConfig config;
+
+    mutable std::mutex cache_mutex;
+    std::unordered_map<long, Token> cache;
+    std::deque<std::pair<Clock::time_point, long>> expiry_order; // one entry per insertion, the TTL is fixed so this is expiry order
+
+    mutable std::mutex queue_mutex;
+    std::condition_variable request_available;
+    std::deque<Request> queue;
+    bool stopping = false;
+    size_t requests = 0;
+    size_t batches = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    LatencyHistogram latencies;
+    std::thread dispatcher;
+};
+
+#endif
\ No newline at end of file
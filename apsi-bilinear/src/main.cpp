@@ -33,6 +33,10 @@ int main() {
     );
 
     benchmark(10, {2, 3, 5, 10, 20, 30, 40, 50, 100}, 256, 1024, -30);
+    benchmark_tree_aggregation(5, {10, 50, 100}, 256, 1024, -30, {0, 2, 4, 8, 16});
+    benchmark_gbf_construction(5, {256, 1024, 4096}, -30);
+    benchmark_judge_service(10, {1, 4, 16}, 1024, 90);
+    benchmark_curves(5, 10, 256, 1024, -30, {"BN254", "BLS12-381", "BLS12-377"});
 
     return 0;
 }
\ No newline at end of file
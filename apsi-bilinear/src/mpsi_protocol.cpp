@@ -2,7 +2,13 @@
 #include <chrono>
 #include <string>
 #include <random>
+#include <stdexcept>
 #include <mcl/bn.hpp>
+#include "pairing_engine.hpp"
+#include "parallel.hpp"
+#include "gt_compression.hpp"
+#include "hash_to_curve.hpp"
+#include "batch_mul.hpp"
 
 using namespace std;
 using namespace mcl::bn;
@@ -33,29 +39,24 @@ string random_string(size_t length) {
     return random_string;
 }
 
-G1 hash_to_G1(long element) {
-    G1 h;
-    std::string s = std::to_string(element) + "_ID_S";
-    hashAndMapToG1(h, s.c_str(), s.size());
-    return h;
+// Targets e(H1(x)^{s_i}, pk) of a whole set: hashing, the s_i multiplication and the
+// precomputed-pk Miller loop of each element run in parallel
+std::vector<GT> compute_targets(const std::vector<long>& set, const Fr& s_i, const G2& pk) {
+    const PairingEngine& pk_engine = cached_pairing_engine(pk);
+    std::vector<GT> targets(set.size());
+    parallel_for(set.size(), pk_engine.thread_count, [&](size_t i) {
+        G1 h1_x_si;
+        G1::mul(h1_x_si, hash_to_G1(set[i]), s_i);
+        pk_engine.pair(targets[i], h1_x_si); // e(H1(x)^{s_i}, pk)
+    });
+    return targets;
 }
 
 GarbledBloomFilter compute_gbf(const std::vector<long>& set, 
                             const BloomFilterParams& bf_params, 
                             const Fr& s_i,
                             const G2& pk) {
-    std::vector<GT> targets;
-    for (size_t x : set) {
-        G1 h1_x = hash_to_G1(x);
-        
-        G1 h1_x_si;
-        G1::mul(h1_x_si, h1_x, s_i); 
-        
-        GT target;
-        pairing(target, h1_x_si, pk); // e(H1(x)^{s_i}, pk)
-        
-        targets.push_back(target);
-    }
+    std::vector<GT> targets = compute_targets(set, s_i, pk);
 
     GarbledBloomFilter gbf(bf_params);
     gbf.insert_set(set, targets);
@@ -78,26 +79,80 @@ std::vector<GT> aggregate_gbfs(const std::vector<GarbledBloomFilter>& gbfs,
 
 std::vector<G1> authorize(const std::vector<long>& server_set, const Fr& judge_sk) {
     std::vector<G1> judge_signatures;
-    for (long x : server_set) {
-        G1 h1_x = hash_to_G1(x);
-        G1 sigma;
-        G1::mul(sigma, h1_x, judge_sk); // \sigma = H1(x||ID_S)^{sk}
-        judge_signatures.push_back(sigma);
-    }
+    batch_mul_G1(judge_signatures, hash_to_G1_batch(server_set), judge_sk); // \sigma = H1(x||ID_S)^{sk}
     return judge_signatures;
 }
 
+std::vector<GT> tree_aggregate_gbfs(
+    const std::vector<GarbledBloomFilter>& gbfs,
+    const std::vector<std::vector<uint8_t>>& wire_gbfs,
+    const std::vector<G2>& S_values,
+    int fan_out,
+    G2* S_agg,
+    double* critical_path_time,
+    size_t* total_sent_bytes,
+    size_t* root_received_bytes
+) {
+    using namespace std::chrono;
+    struct Node {
+        std::vector<GT> bins;
+        std::vector<uint8_t> wire; // what the node forwards to its group leader
+        G2 S;
+    };
+    std::vector<Node> level;
+    for (size_t i = 0; i < gbfs.size(); i++) 
+        level.push_back({gbfs[i].bins, wire_gbfs[i], S_values[i]});
+
+    // Every group of fan_out nodes sends its aggregate to the first node of the group,
+    // the leader client is always the first node, so it ends up as the root
+    while (level.size() > 1) {
+        bool root_level = level.size() <= static_cast<size_t>(fan_out);
+        std::vector<Node> next_level;
+        double slowest_group = 0.0;
+        for (size_t leader = 0; leader < level.size(); leader += fan_out) {
+            auto start = high_resolution_clock::now();
+            Node aggregated = std::move(level[leader]);
+            for (size_t child = leader + 1; child < std::min(leader + fan_out, level.size()); child++) {
+                std::vector<GT> child_bins;
+                if (!deserialize_gts_compressed(level[child].wire, child_bins) || 
+                    child_bins.size() != aggregated.bins.size()) 
+                    throw std::runtime_error("Malformed GBF from tree node " + std::to_string(child));
+                for (size_t v = 0; v < aggregated.bins.size(); v++) 
+                    GT::mul(aggregated.bins[v], aggregated.bins[v], child_bins[v]);
+                G2::add(aggregated.S, aggregated.S, level[child].S);
+
+                size_t child_bytes = level[child].wire.size() + get_element_size(level[child].S);
+                *total_sent_bytes += child_bytes;
+                // the leader client is node 0 at every level, so it also receives below the root
+                if (leader == 0) 
+                    *root_received_bytes += child_bytes;
+            }
+            if (!root_level) 
+                aggregated.wire = serialize_gts_compressed(aggregated.bins);
+            auto stop = high_resolution_clock::now();
+            slowest_group = std::max(slowest_group, duration<double, std::milli>(stop - start).count());
+            next_level.push_back(std::move(aggregated));
+        }
+        *critical_path_time += slowest_group;
+        level = std::move(next_level);
+    }
+    *S_agg = level[0].S;
+    return std::move(level[0].bins);
+}
+
 std::vector<long> intersect(const std::vector<long>& server_set,
                             const std::vector<G1>& judge_signatures,
                             const G2& S_agg,
                             const std::vector<GT>& aggregated_gbf, 
                             const BloomFilterParams& bf_params) {
     std::vector<long> intersection;
+
+    // \hat{x}_j = e(\sigma_j, S_{agg}), S_{agg} is shared by all elements
+    PairingEngine engine(S_agg);
+    std::vector<GT> expected_targets = engine.pair_batch(judge_signatures);
     
     for (size_t j = 0; j < server_set.size(); j++) {
-        // \hat{x}_j = e(\sigma_j, S_{agg})
-        GT expected_target;
-        pairing(expected_target, judge_signatures[j], S_agg);
+        const GT& expected_target = expected_targets[j];
 
         // \hat{y}_j = \prod GBF_{agg}[h_u(x)]
         GT actual_target;
@@ -136,7 +191,8 @@ std::vector<long> multiparty_psi(
     size_t* leader_client_sent_bytes,
     size_t* leader_client_received_bytes,
     size_t* judge_sent_bytes,
-    size_t* judge_received_bytes
+    size_t* judge_received_bytes,
+    int fan_out
 ) {
     using namespace std::chrono;
     int n_clients = client_sets.size();
@@ -165,6 +221,7 @@ std::vector<long> multiparty_psi(
     auto client_start = high_resolution_clock::now();
     std::vector<G2> S_values;
     std::vector<GarbledBloomFilter> gbfs;
+    std::vector<std::vector<uint8_t>> wire_gbfs; // T2-compressed bins, as sent to the leader
     G2 g2_gen; 
     mapToG2(g2_gen, 1);
 
@@ -180,45 +237,68 @@ std::vector<long> multiparty_psi(
         
         // GBF
         gbfs.push_back(compute_gbf(set, bf_params, s_i, judge_pk));
+        wire_gbfs.push_back(serialize_gts_compressed(gbfs.back().bins));
     }
     auto client_stop = high_resolution_clock::now();
     *client_prep_time = duration<double, std::milli>(client_stop - client_start).count() / n_clients;
 
     // Online Phase
-    // Each client sends their S value and GBF to the leader client (client 1)
-    size_t total_gbf_and_s_values_bytes = 0;
-    for (size_t i = 1; i < n_clients; i++) {
-        total_gbf_and_s_values_bytes += get_element_size(S_values[i]);
-        for (const auto& bin : gbfs[i].bins) 
-            total_gbf_and_s_values_bytes += get_element_size(bin);
-    }
-    if (n_clients > 1) {
-        *client_sent_bytes += total_gbf_and_s_values_bytes / (n_clients - 1);
-        *leader_client_received_bytes += total_gbf_and_s_values_bytes;
-    }
+    std::vector<GT> aggregated_gbf;
+    G2 S_agg;
+    std::vector<uint8_t> wire_aggregated_gbf;
+    if (fan_out > 1) {
+        // Clients multiply their GBFs and add their S values up a tree rooted at the leader client
+        size_t tree_sent_bytes = 0;
+        double critical_path_time = 0.0;
+        aggregated_gbf = tree_aggregate_gbfs(gbfs, wire_gbfs, S_values, fan_out, &S_agg, 
+                                             &critical_path_time, &tree_sent_bytes, leader_client_received_bytes);
+        if (n_clients > 1) 
+            *client_sent_bytes += tree_sent_bytes / (n_clients - 1);
+
+        auto leader_start = high_resolution_clock::now();
+        wire_aggregated_gbf = serialize_gts_compressed(aggregated_gbf);
+        auto leader_stop = high_resolution_clock::now();
+        *client_online_time = critical_path_time + duration<double, std::milli>(leader_stop - leader_start).count();
+    } else {
+        // Each client sends their S value and GBF to the leader client (client 1)
+        size_t total_gbf_and_s_values_bytes = 0;
+        for (size_t i = 1; i < n_clients; i++) {
+            total_gbf_and_s_values_bytes += get_element_size(S_values[i]);
+            total_gbf_and_s_values_bytes += wire_gbfs[i].size();
+        }
+        if (n_clients > 1) {
+            *client_sent_bytes += total_gbf_and_s_values_bytes / (n_clients - 1);
+            *leader_client_received_bytes += total_gbf_and_s_values_bytes;
+        }
     
-    // The leader client aggregates the S values and GBFs
-    auto leader_start = high_resolution_clock::now();
-    std::vector<GT> aggregated_gbf = aggregate_gbfs(gbfs, n_clients, bf_params);
-    G2 S_agg; 
-    S_agg.clear(); 
-    for (const auto& S_i : S_values) {
-        G2::add(S_agg, S_agg, S_i); // exponent multiplications
+        // The leader client aggregates the S values and GBFs
+        auto leader_start = high_resolution_clock::now();
+        for (int i = 1; i < n_clients; i++) {
+            if (!deserialize_gts_compressed(wire_gbfs[i], gbfs[i].bins) || gbfs[i].bins.size() != bf_params.bin_count) 
+                throw std::runtime_error("Malformed GBF from client " + std::to_string(i + 1));
+        }
+        aggregated_gbf = aggregate_gbfs(gbfs, n_clients, bf_params);
+        S_agg.clear(); 
+        for (const auto& S_i : S_values) {
+            G2::add(S_agg, S_agg, S_i); // exponent multiplications
+        }
+        wire_aggregated_gbf = serialize_gts_compressed(aggregated_gbf);
+        auto leader_stop = high_resolution_clock::now();
+        *client_online_time = duration<double, std::milli>(leader_stop - leader_start).count();
     }
-    auto leader_stop = high_resolution_clock::now();
-    *client_online_time = duration<double, std::milli>(leader_stop - leader_start).count();
 
     // The leader client sends the aggregated S and GBFs to the server
-    for (const auto& bin : aggregated_gbf) {
-        *leader_client_sent_bytes += get_element_size(bin);
-        *server_received_bytes += get_element_size(bin);
-    }
+    *leader_client_sent_bytes += wire_aggregated_gbf.size();
+    *server_received_bytes += wire_aggregated_gbf.size();
     *leader_client_sent_bytes += get_element_size(S_agg);
     *server_received_bytes += get_element_size(S_agg);
 
     // The server computes the intersection
     auto server_start = high_resolution_clock::now();
-    std::vector<long> intersection = intersect(server_set, judge_signatures, S_agg, aggregated_gbf, bf_params);
+    std::vector<GT> received_gbf;
+    if (!deserialize_gts_compressed(wire_aggregated_gbf, received_gbf) || received_gbf.size() != bf_params.bin_count) 
+        throw std::runtime_error("Malformed aggregated GBF from the leader client");
+    std::vector<long> intersection = intersect(server_set, judge_signatures, S_agg, received_gbf, bf_params);
     auto server_stop = high_resolution_clock::now();
     *server_computation_time = duration<double, std::milli>(server_stop - server_start).count();
 
@@ -2,9 +2,13 @@
 #define MPSI_PROTOCOL_HPP
 
 #include <vector>
+#include <cstdint>
 #include <NTL/ZZ.h>
 #include "bloom_filter.hpp"
 
+// Judge signatures H1(x||ID_S)^{sk} over the server set
+std::vector<G1> authorize(const std::vector<long>& server_set, const Fr& judge_sk);
+
 std::vector<long> multiparty_psi(
     const std::vector<std::vector<long>>& client_sets,
     const std::vector<long>& server_set,
@@ -21,7 +25,22 @@ std::vector<long> multiparty_psi(
     size_t* leader_client_sent_bytes,
     size_t* leader_client_received_bytes,
     size_t* judge_sent_bytes,
-    size_t* judge_received_bytes
+    size_t* judge_received_bytes,
+    int fan_out = 0 // > 1: clients aggregate their GBFs in a tree of this fan-out instead of all sending to the leader
+);
+
+// Bin-wise product of the clients' GBFs and sum of their S values over a tree with the given
+// fan-out, rooted at the leader client (client 0). Aggregates travel T2-compressed. Every level's
+// groups work in parallel, so the critical path is the sum of the slowest group of each level.
+std::vector<GT> tree_aggregate_gbfs(
+    const std::vector<GarbledBloomFilter>& gbfs,
+    const std::vector<std::vector<uint8_t>>& wire_gbfs,
+    const std::vector<G2>& S_values,
+    int fan_out,
+    G2* S_agg,
+    double* critical_path_time,
+    size_t* total_sent_bytes,
+    size_t* root_received_bytes
 );
 
 #endif 
\ No newline at end of file
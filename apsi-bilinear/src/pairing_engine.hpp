@@ -0,0 +1,25 @@
+#ifndef PAIRING_ENGINE_HPP
+#define PAIRING_ENGINE_HPP
+
+#include <vector>
+#include <mcl/bn.hpp>
+
+using namespace mcl::bn;
+
+// Pairings e(P, Q) against one fixed G2 point Q. The Miller-loop line coefficients of Q are
+// computed once, the per-point Miller loops and final exponentiations run on a thread pool.
+struct PairingEngine {
+    std::vector<Fp6> q_coeffs;
+    size_t thread_count; // 0 = one thread per core
+
+    explicit PairingEngine(const G2& q, size_t thread_count = 0);
+
+    void pair(GT& e, const G1& p) const;
+    std::vector<GT> pair_batch(const std::vector<G1>& ps) const;
+};
+
+// Engine for a long-lived G2 point such as the judge's public key, built on first use and
+// shared by every later session (thread-safe)
+const PairingEngine& cached_pairing_engine(const G2& q);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// 0 selects one thread per hardware core
+inline size_t resolve_thread_count(size_t thread_count) {
+    if (thread_count == 0) 
+        thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+    return thread_count;
+}
+
+// Calls f(i) for every i in [0, count). Workers claim chunks of indices from a shared counter,
+// so uneven per-item costs do not leave threads idle.
+template <typename F>
+void parallel_for(size_t count, size_t thread_count, F f, size_t chunk = 16) {
+    thread_count = std::min(resolve_thread_count(thread_count), (count + chunk - 1) / chunk);
+    if (thread_count <= 1) {
+        for (size_t i = 0; i < count; i++) 
+            f(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t begin = next.fetch_add(chunk); begin < count; begin = next.fetch_add(chunk)) {
+            size_t end = std::min(count, begin + chunk);
+            for (size_t i = begin; i < end; i++) 
+                f(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t t = 1; t < thread_count; t++) 
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads) 
+        thread.join();
+}
+
+#endif
\ No newline at end of file
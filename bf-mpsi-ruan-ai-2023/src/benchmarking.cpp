@@ -5,76 +5,230 @@
 #include <cmath>
 #include <algorithm>
 #include <random>
+#include <fstream>
+#include <filesystem>
 #include "mpsi_protocol.hpp" 
 
-double sample_mean(const std::vector<long>& measurements) {
+double sample_mean_computation(const std::vector<double>& measurements) {
     double sum = 0;
-    for (long measurement : measurements) {
+    for (double measurement : measurements) {
         sum += measurement;
     }
     return sum / measurements.size();
 }
 
-double sample_std(const std::vector<long>& measurements, double mean) {
+double sample_mean_communication(const std::vector<size_t>& measurements) {
+    double sum = 0;
+    for (size_t measurement : measurements) {
+        sum += measurement;
+    }
+    return sum / measurements.size();
+}
+
+double sample_std_computation(const std::vector<double>& measurements, double mean) {
     if (measurements.size() <= 1) return 0.0;
     double sum = 0;
-    for (long measurement : measurements) {
+    for (double measurement : measurements) {
         sum += std::pow(measurement - mean, 2);
     }
     return std::sqrt(sum / (measurements.size() - 1.0));
 }
 
+double sample_std_communication(const std::vector<size_t>& measurements, double mean) {
+    if (measurements.size() <= 1) return 0.0;
+    double sum = 0;
+    for (size_t measurement : measurements) {
+        sum += std::pow(measurement - mean, 2);
+    }
+    return std::sqrt(sum / (measurements.size() - 1.0));
+}
+
+std::vector<size_t> sample_unique_set(size_t set_size, size_t universe_size) {
+    std::vector<size_t> set;
+    set.reserve(set_size);
+    for (size_t k = 0; k < set_size; ++k) set.push_back(rand() % universe_size);
+    std::sort(set.begin(), set.end());
+    set.erase(std::unique(set.begin(), set.end()), set.end());
+    return set;
+}
+
 void benchmark(std::vector<long> parties_list, std::vector<long> set_size_exponents) {
     size_t universe_size = 1000000; 
+    const int repetitions = 10;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream comp_csv("../data/computation.csv");
+    comp_csv << "Parties,Set Size,Client Prep,Client Online,Server Prep,Server Online,Server Online CPU\n";
+    std::ofstream comm_csv("../data/communication.csv");
+    comm_csv << "Parties,Set Size,Client Sent,Client Received,Server Sent,Server Received\n";
+    std::ofstream sim_csv("../data/simulation.csv");
+    sim_csv << "Parties,Set Size,LAN (2.5 GBps),125 MBps,25 MBps,6.25 MBps,625 KBps\n";
 
     for (long t : parties_list) {
         std::cout << "\nBenchmarking " << t << " parties" << std::endl;
-        std::cout << "Format: (Mean Time ms, Std Dev ms)" << std::endl;
         
         for (long exp : set_size_exponents) {
-            std::cout << "Results for set size 2^" << exp << ": ";
             size_t set_size = 1 << exp; 
             
             std::vector<std::vector<std::vector<size_t>>> experiment_client_sets;
             std::vector<std::vector<size_t>> experiment_server_sets;
             
-            for (int i = 0; i < 10; ++i) { // 10 iterations
+            for (int i = 0; i < repetitions; ++i) {
                 std::vector<std::vector<size_t>> client_sets;
                 for (int j = 0; j < t; ++j) {
-                    std::vector<size_t> set;
-                    set.reserve(set_size);
-                    for (size_t k = 0; k < set_size; ++k) set.push_back(rand() % universe_size);
-                    std::sort(set.begin(), set.end());
-                    set.erase(std::unique(set.begin(), set.end()), set.end());
-                    client_sets.push_back(set);
+                    client_sets.push_back(sample_unique_set(set_size, universe_size));
                 }
                 experiment_client_sets.push_back(client_sets);
-
-                std::vector<size_t> s_set;
-                s_set.reserve(set_size);
-                for (size_t k = 0; k < set_size; ++k) s_set.push_back(rand() % universe_size);
-                std::sort(s_set.begin(), s_set.end());
-                s_set.erase(std::unique(s_set.begin(), s_set.end()), s_set.end());
-                experiment_server_sets.push_back(s_set);
+                experiment_server_sets.push_back(sample_unique_set(set_size, universe_size));
             }
 
             BloomFilterParams params(set_size, -30);
             Keys keys;
             key_gen(&keys, 1024, t); 
 
-            std::vector<long> times;
-            for (int i = 0; i < 10; ++i) {
-                auto start = std::chrono::high_resolution_clock::now();
-                multiparty_psi(experiment_client_sets[i], experiment_server_sets[i], params, keys);
-                auto stop = std::chrono::high_resolution_clock::now();
-                times.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+            std::cout << "\nSet size 2^" << exp << ", Params: m=" << params.bin_count << ", k=" << params.seeds.size() << std::endl;
+
+            std::vector<double> client_prep_times;
+            std::vector<double> client_online_times;
+            std::vector<double> server_prep_times;
+            std::vector<double> server_online_times;
+            std::vector<double> server_online_cpu_times;
+            std::vector<size_t> server_sent_bytes_all;
+            std::vector<size_t> server_received_bytes_all;
+            std::vector<size_t> client_sent_bytes_all;
+            std::vector<size_t> client_received_bytes_all;
+
+            for (int i = 0; i < repetitions; ++i) {
+                double client_prep_time = 0.0;
+                double client_online_time = 0.0;
+                double server_prep_time = 0.0;
+                double server_online_time = 0.0;
+                double server_online_cpu_time = 0.0;
+                size_t server_sent_bytes = 0;
+                size_t server_received_bytes = 0;
+                size_t client_sent_bytes = 0;
+                size_t client_received_bytes = 0;
+
+                multiparty_psi(
+                    experiment_client_sets[i], 
+                    experiment_server_sets[i], 
+                    params, 
+                    keys,
+                    &client_prep_time,
+                    &client_online_time,
+                    &server_prep_time,
+                    &server_online_time,
+                    &server_sent_bytes,
+                    &server_received_bytes,
+                    &client_sent_bytes,
+                    &client_received_bytes,
+                    0,
+                    &server_online_cpu_time
+                );
+
+                client_prep_times.push_back(client_prep_time);
+                client_online_times.push_back(client_online_time);
+                server_prep_times.push_back(server_prep_time);
+                server_online_times.push_back(server_online_time);
+                server_online_cpu_times.push_back(server_online_cpu_time);
+                server_sent_bytes_all.push_back(server_sent_bytes);
+                server_received_bytes_all.push_back(server_received_bytes);
+                client_sent_bytes_all.push_back(client_sent_bytes);
+                client_received_bytes_all.push_back(client_received_bytes);
             }
 
-            double mean = sample_mean(times);
-            double std = sample_std(times, mean);
+            double mean_client_prep = sample_mean_computation(client_prep_times);
+            double std_dev = sample_std_computation(client_prep_times, mean_client_prep);
+            std::cout << "Client prep time (ms): mean " << std::fixed << mean_client_prep << ", std dev " << std_dev << std::endl;
+
+            double mean_client_online = sample_mean_computation(client_online_times);
+            std_dev = sample_std_computation(client_online_times, mean_client_online);
+            std::cout << "Client online time (ms): mean " << std::fixed << mean_client_online << ", std dev " << std_dev << std::endl;
+
+            double mean_server_prep = sample_mean_computation(server_prep_times);
+            std_dev = sample_std_computation(server_prep_times, mean_server_prep);
+            std::cout << "Server prep time (ms): mean " << std::fixed << mean_server_prep << ", std dev " << std_dev << std::endl;
+
+            double mean_server_online = sample_mean_computation(server_online_times);
+            std_dev = sample_std_computation(server_online_times, mean_server_online);
+            std::cout << "Server online time (ms): mean " << std::fixed << mean_server_online << ", std dev " << std_dev << std::endl;
+
+            double mean_server_online_cpu = sample_mean_computation(server_online_cpu_times);
+            std_dev = sample_std_computation(server_online_cpu_times, mean_server_online_cpu);
+            std::cout << "Server online CPU time (ms): mean " << std::fixed << mean_server_online_cpu << ", std dev " << std_dev << std::endl;
+
+            double mean_server_sent = sample_mean_communication(server_sent_bytes_all);
+            std_dev = sample_std_communication(server_sent_bytes_all, mean_server_sent);
+            std::cout << "Server sent bytes: mean " << std::fixed << mean_server_sent << ", std dev " << std_dev << std::endl;
+
+            double mean_server_received = sample_mean_communication(server_received_bytes_all);
+            std_dev = sample_std_communication(server_received_bytes_all, mean_server_received);
+            std::cout << "Server received bytes: mean " << std::fixed << mean_server_received << ", std dev " << std_dev << std::endl;
+
+            double mean_client_sent = sample_mean_communication(client_sent_bytes_all);
+            std_dev = sample_std_communication(client_sent_bytes_all, mean_client_sent);
+            std::cout << "Client sent bytes: mean " << std::fixed << mean_client_sent << ", std dev " << std_dev << std::endl;
+
+            double mean_client_received = sample_mean_communication(client_received_bytes_all);
+            std_dev = sample_std_communication(client_received_bytes_all, mean_client_received);
+            std::cout << "Client received bytes: mean " << std::fixed << mean_client_received << ", std dev " << std_dev << std::endl;
+
+            comp_csv << t << "," 
+                    << set_size << ","
+                    << mean_client_prep << ","  
+                    << mean_client_online << "," 
+                    << mean_server_prep << "," 
+                    << mean_server_online << ","
+                    << mean_server_online_cpu << "\n";
+
+            comm_csv << t << "," 
+                    << set_size << ","
+                    << mean_client_sent << "," 
+                    << mean_client_received << ","
+                    << mean_server_sent << "," 
+                    << mean_server_received << "\n";
+
+            // Network Simulation 
+            size_t bandwidth_lan = 2500000000; // 2.5 GBps
+            size_t bandwidth_0 = 125000000; // 125 MBps
+            size_t bandwidth_1 = 25000000; // 25 MBps
+            size_t bandwidth_2 = 6250000; // 6.25 MBps
+            size_t bandwidth_3 = 625000; // 625 KBps
+
+            const double LATENCY_LAN = 0.1; // ms
+            const double LATENCY_WAN = 80.0; // ms
+            const size_t MESSAGES = 3; // encrypted BFs, combined c2s, decryption shares
+
+            double total_comp_time = mean_client_prep + mean_client_online + mean_server_prep + mean_server_online;
+            double bandwidth_total_bytes = mean_server_sent + mean_server_received;
+            std::cout << "\nTotal Computation Time (ms): " << total_comp_time << std::endl;
+            std::cout << "Total Communication (bytes): " << bandwidth_total_bytes << std::endl;
+
+            auto calc_net_time = [&](double latency_ms, double bandwidth_bps) {
+                // latency + communication_time + computation_time
+                return (latency_ms * MESSAGES) + (bandwidth_total_bytes / bandwidth_bps)  + total_comp_time;
+            };
+
+            double time_lan = calc_net_time(LATENCY_LAN, bandwidth_lan);
+            double time_network_0 = calc_net_time(LATENCY_WAN, bandwidth_0);
+            double time_network_1 = calc_net_time(LATENCY_WAN, bandwidth_1);
+            double time_network_2 = calc_net_time(LATENCY_WAN, bandwidth_2);
+            double time_network_3 = calc_net_time(LATENCY_WAN, bandwidth_3);
+
+            std::cout << "\nSimulated Total Times (Communication + Computation):" << std::endl;
+            std::cout << "Banwidth 2.5 GBps, Latency " << time_lan << " ms (LAN)" << std::endl; 
+            std::cout << "Banwidth 125 MBps, Latency " << time_network_0 << " ms (1 Gbps)" << std::endl;
+            std::cout << "Banwidth 25 MBps, Latency " << time_network_1 << " ms (200 Mbps)" << std::endl;
+            std::cout << "Banwidth 6.25 MBps, Latency " << time_network_2 << " ms (20 Mbps)" << std::endl;
+            std::cout << "Banwidth 625 KBps, Latency " << time_network_3 << " ms (5 Mbps)" << std::endl;
 
-            std::cout << "(" << mean << ", " << std << "),\n";
-            std::cout.flush(); 
+            sim_csv << t << "," 
+                    << set_size << ","
+                    << time_lan << "," 
+                    << time_network_0 << "," 
+                    << time_network_1 << ","
+                    << time_network_2 << "," 
+                    << time_network_3 << "\n";
         }
     }
 }
\ No newline at end of file
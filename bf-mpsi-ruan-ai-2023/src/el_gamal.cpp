@@ -61,6 +61,17 @@ ZZ decrypt_share(const ZZ& Y, const ZZ& c1, const ZZ& sk, const PublicParameters
     return MulMod(Y, denominator_inv, params.p);
 }
 
+ZZ share_exponent(const ZZ& sk, long num_parties, const PublicParameters& params) {
+    // g generates all of Z_p^*, so exponents live modulo p - 1
+    ZZ order = params.p - 1;
+    return order - MulMod(sk % order, to_ZZ(num_parties) % order, order);
+}
+
+ZZ decrypt_share_inverse_free(const ZZ& Y, const ZZ& c1, const ZZ& exponent, const PublicParameters& params) {
+    // Y * c1^((p - 1) - sk * t) = Y / (c1^(sk * t)) mod p
+    return MulMod(Y, PowerMod(c1, exponent, params.p), params.p);
+}
+
 ZZ combine_decryption_shares(const std::vector<ZZ>& shares, const PublicParameters& params) {
     ZZ combined_bf = to_ZZ(1);
     for (const auto& s : shares) {
@@ -35,6 +35,11 @@ ZZ join_encrypted_data(const std::vector<ZZ>& c2_values, const PublicParameters&
 
 ZZ decrypt_share(const ZZ& Y, const ZZ& c1, const ZZ& sk, const PublicParameters& params, long num_parties);
 
+// (p - 1) - (sk * t mod (p - 1)), so that c1^e = c1^(-sk * t) without an inversion
+ZZ share_exponent(const ZZ& sk, long num_parties, const PublicParameters& params);
+
+ZZ decrypt_share_inverse_free(const ZZ& Y, const ZZ& c1, const ZZ& exponent, const PublicParameters& params);
+
 ZZ combine_decryption_shares(const std::vector<ZZ>& shares, const PublicParameters& params);
 
 #endif
\ No newline at end of file
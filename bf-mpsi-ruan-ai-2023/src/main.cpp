@@ -68,18 +68,34 @@ std::vector<size_t> run_experiment(const std::vector<std::vector<size_t>>& clien
               << ", m=" << global_params.bin_count 
               << ", k=" << global_params.seeds.size() << std::endl;
 
-    auto start = std::chrono::high_resolution_clock::now();
+    double client_prep_time = 0.0;
+    double client_online_time = 0.0;
+    double server_prep_time = 0.0;
+    double server_online_time = 0.0;
+    size_t server_sent_bytes = 0;
+    size_t server_received_bytes = 0;
+    size_t client_sent_bytes = 0;
+    size_t client_received_bytes = 0;
+
     std::vector<size_t> result = multiparty_psi(
         client_sets, 
         server_set, 
         global_params,
-        keys
+        keys,
+        &client_prep_time,
+        &client_online_time,
+        &server_prep_time,
+        &server_online_time,
+        &server_sent_bytes,
+        &server_received_bytes,
+        &client_sent_bytes,
+        &client_received_bytes
     );
-    auto stop = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
 
     print_set("Result", result);
-    std::cout << "Time: " << duration.count() << " ms" << std::endl;
+    std::cout << "Client prep: " << client_prep_time << " ms, Client online: " << client_online_time 
+              << " ms, Server online: " << server_online_time << " ms" << std::endl;
+    std::cout << "Client sent: " << client_sent_bytes << " bytes, Server sent: " << server_sent_bytes << " bytes" << std::endl;
     std::cout << std::endl;
 
     return result;
@@ -1,5 +1,10 @@
 #include "mpsi_protocol.hpp"
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <chrono>
 
 std::vector<Ciphertext> initialization(
     BloomFilterParams& bf_params,
@@ -31,17 +36,33 @@ std::vector<Ciphertext> initialization(
     return encrypted_bf;
 }
 
+size_t get_ciphertext_size(const Ciphertext& ct) {
+    return NumBytes(ct.c1) + NumBytes(ct.c2);
+}
+
 std::vector<size_t> multiparty_psi(
     const std::vector<std::vector<size_t>>& client_sets,
     const std::vector<size_t>& server_set,
     BloomFilterParams& bf_params,
-    const Keys& keys) 
+    const Keys& keys,
+    double* client_prep_time,
+    double* client_online_time,
+    double* server_prep_time,
+    double* server_online_time,
+    size_t* server_sent_bytes, 
+    size_t* server_received_bytes,
+    size_t* client_sent_bytes,
+    size_t* client_received_bytes,
+    size_t thread_count,
+    double* server_online_cpu_time) 
 {
+    using namespace std::chrono;
     size_t num_clients_t = client_sets.size();
     size_t m_bits = bf_params.bin_count;
     size_t k_hashes = bf_params.seeds.size();
     
     // Initialization - clients generate encrypted Bloom Filters
+    auto start = high_resolution_clock::now();
     std::vector<std::vector<Ciphertext>> client_ebfs;
     client_ebfs.reserve(num_clients_t);
     for(size_t i=0; i<num_clients_t; ++i) {
@@ -54,53 +75,141 @@ std::vector<size_t> multiparty_psi(
             keys.params
         ));
     }
+    auto stop = high_resolution_clock::now();
+    *client_prep_time = duration<double, std::milli>(stop - start).count() / num_clients_t;
+
+    // The server has no preparation in this variant
+    *server_prep_time = 0.0;
+
+    // Clients send their encrypted Bloom Filters to the server
+    size_t all_ebfs_size_bytes = 0;
+    for (const auto& ebf : client_ebfs) 
+        for (const auto& ct : ebf) 
+            all_ebfs_size_bytes += get_ciphertext_size(ct);
+    *client_sent_bytes += all_ebfs_size_bytes / num_clients_t;
+    *server_received_bytes += all_ebfs_size_bytes;
 
     // Computation Intersection
-    // Steps 1 & 2 - Server computes combined encrypted BF
-    std::vector<ZZ> combined_ebf;
-    combined_ebf.reserve(m_bits);
-
-    for(long j=0; j<m_bits; ++j) {
-        ZZ combined_ct_c2s = ZZ(1); 
-        for(size_t i=0; i<num_clients_t; ++i) { 
-            combined_ct_c2s = MulMod(combined_ct_c2s, client_ebfs[i][j].c2, keys.params.p);
-        }
-        combined_ebf.push_back(combined_ct_c2s);
+    // Steps 1 - 4 run as one pipeline per bin range: combine the c2s, compute every
+    // client's share, combine the shares and set the bit, so no m x n share matrix is kept
+    std::vector<ZZ> exponents;
+    for(size_t i=0; i<num_clients_t; ++i) {
+        exponents.push_back(share_exponent(keys.key_pairs[i].sk, num_clients_t, keys.params));
     }
 
-    // Step 3 - Each client computes their decryption share
-    std::vector<std::vector<ZZ>> all_bin_shares;
-    all_bin_shares.reserve(num_clients_t);
+    // Each worker times its steps per bin range. The server's wall-clock time is the longest
+    // any worker spent in server steps, its CPU time the sum over workers. Every client only
+    // computes its own shares, so a client's time is the client CPU time summed over workers
+    // divided by the number of clients.
+    double server_step_wall_time = 0.0;
+    double server_step_cpu_time = 0.0;
+    double client_step_cpu_time = 0.0;
+    size_t combined_size_bytes = 0;
+    size_t shares_size_bytes = 0;
+    std::mutex totals_mutex;
+
+    std::vector<unsigned char> final_bits(m_bits, 0);
+    std::atomic<size_t> next_bin(0);
+    const size_t BINS_PER_RANGE = 64;
+    auto worker = [&]() {
+        double server_time = 0.0;
+        double client_time = 0.0;
+        size_t combined_bytes = 0;
+        size_t shares_bytes = 0;
+        std::vector<ZZ> combined_ct_c2s(BINS_PER_RANGE);
+        std::vector<std::vector<ZZ>> shares(BINS_PER_RANGE, std::vector<ZZ>(num_clients_t));
+        while (true) {
+            size_t begin = next_bin.fetch_add(BINS_PER_RANGE);
+            if (begin >= m_bits) 
+                break;
+            size_t end = std::min(begin + BINS_PER_RANGE, m_bits);
+
+            // Steps 1 & 2 - Server combines the c2s of every bin in the range
+            auto step_start = high_resolution_clock::now();
+            for(size_t j = begin; j < end; ++j) {
+                ZZ& combined = combined_ct_c2s[j - begin];
+                combined = ZZ(1);
+                for(size_t i=0; i<num_clients_t; ++i) { 
+                    combined = MulMod(combined, client_ebfs[i][j].c2, keys.params.p);
+                }
+            }
+            auto step_stop = high_resolution_clock::now();
+            server_time += duration<double, std::milli>(step_stop - step_start).count();
+
+            // Step 3 - Each client computes their decryption shares
+            step_start = high_resolution_clock::now();
+            for(size_t j = begin; j < end; ++j) {
+                for(size_t i=0; i<num_clients_t; ++i) {
+                    shares[j - begin][i] = decrypt_share_inverse_free(combined_ct_c2s[j - begin], client_ebfs[i][j].c1, exponents[i], keys.params);
+                }
+            }
+            step_stop = high_resolution_clock::now();
+            client_time += duration<double, std::milli>(step_stop - step_start).count();
 
-    for(size_t j = 0; j < combined_ebf.size(); ++j) {
-        std::vector<ZZ> shares_for_bin_j;
-        for(size_t i=0; i<num_clients_t; ++i) {
-            ZZ share = decrypt_share(combined_ebf[j], client_ebfs[i][j].c1, keys.key_pairs[i].sk, keys.params, num_clients_t); 
-            shares_for_bin_j.push_back(share);
+            // Step 4 - Server combines the shares and sets the bits
+            step_start = high_resolution_clock::now();
+            for(size_t j = begin; j < end; ++j) {
+                ZZ plaintext = combine_decryption_shares(shares[j - begin], keys.params);
+                final_bits[j] = plaintext == 1;
+            }
+            step_stop = high_resolution_clock::now();
+            server_time += duration<double, std::milli>(step_stop - step_start).count();
+
+            for(size_t j = begin; j < end; ++j) {
+                combined_bytes += NumBytes(combined_ct_c2s[j - begin]);
+                for (const auto& share : shares[j - begin]) 
+                    shares_bytes += NumBytes(share);
+            }
         }
-        all_bin_shares.push_back(shares_for_bin_j);
+        std::lock_guard<std::mutex> lock(totals_mutex);
+        server_step_wall_time = std::max(server_step_wall_time, server_time);
+        server_step_cpu_time += server_time;
+        client_step_cpu_time += client_time;
+        combined_size_bytes += combined_bytes;
+        shares_size_bytes += shares_bytes;
+    };
+
+    if (thread_count == 0) 
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> workers;
+    for(size_t w = 1; w < thread_count; ++w) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& t : workers) {
+        t.join();
     }
 
-    // Step 4 - Server computes combined BF
+    *client_online_time += client_step_cpu_time / num_clients_t;
+    *server_online_time += server_step_wall_time;
+    if (server_online_cpu_time) 
+        *server_online_cpu_time += server_step_cpu_time;
+
+    // Server sends the combined c2s to every client, clients send their shares back
+    *server_sent_bytes += combined_size_bytes * num_clients_t;
+    *client_received_bytes += combined_size_bytes;
+    *client_sent_bytes += shares_size_bytes / num_clients_t;
+    *server_received_bytes += shares_size_bytes;
+
+    // Step 5 - Server computes intersection
+    start = high_resolution_clock::now();
     BloomFilter final_bf(bf_params); 
-    for(long j=0; j<m_bits; ++j) {
-        std::vector<ZZ> shares_for_bin_j;
-        for(size_t i=0; i<num_clients_t; ++i) {
-            shares_for_bin_j.push_back(all_bin_shares[j][i]);
-        }
-        ZZ plaintext = combine_decryption_shares(shares_for_bin_j, keys.params);
-        if (plaintext == 1) {
+    for(size_t j=0; j<m_bits; ++j) {
+        if (final_bits[j]) {
             final_bf.set_bit_manually(j, true); 
         }
     }
 
-    // Step 5 - Server computes intersection
     std::vector<size_t> intersection;
     for(size_t elem : server_set) {
         if(final_bf.contains(elem)) {
             intersection.push_back(elem);
         }
     }
+    stop = high_resolution_clock::now();
+    *server_online_time += duration<double, std::milli>(stop - start).count();
+    if (server_online_cpu_time) 
+        *server_online_cpu_time += duration<double, std::milli>(stop - start).count();
 
     return intersection;
 }
\ No newline at end of file
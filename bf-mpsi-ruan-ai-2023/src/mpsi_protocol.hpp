@@ -10,7 +10,17 @@ std::vector<size_t> multiparty_psi(
     const std::vector<std::vector<size_t>>& client_sets,
     const std::vector<size_t>& server_set,
     BloomFilterParams& bf_params,
-    const Keys& keys
+    const Keys& keys,
+    double* client_prep_time,
+    double* client_online_time,
+    double* server_prep_time,
+    double* server_online_time,
+    size_t* server_sent_bytes, 
+    size_t* server_received_bytes,
+    size_t* client_sent_bytes,
+    size_t* client_received_bytes,
+    size_t thread_count = 0, // bin-range workers, 0 uses every hardware thread
+    double* server_online_cpu_time = nullptr // server online time summed over the workers, if given
 );
 
 #endif 
\ No newline at end of file
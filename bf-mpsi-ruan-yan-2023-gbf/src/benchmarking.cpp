@@ -5,6 +5,7 @@
 #include <cmath>
 #include <algorithm>
 #include <random>
+#include <string>
 #include <unistd.h>
 #include "mpsi_protocol.hpp" 
 #include "experiments.hpp"
@@ -257,4 +258,105 @@ void benchmark(long repetitions, std::vector<long> number_of_parties_list, long
         std::cout << "Banwidth 6.25 MBps, Latency " << time_network_2 << " ms (20 Mbps)" << std::endl;
         std::cout << "Banwidth 625 KBps, Latency " << time_network_3 << " ms (5 Mbps)" << std::endl;
     }
+}
+
+void benchmark_encodings(long repetitions, long parties, long set_size_clients, long set_size_server, int false_positive_exponent, double okvs_expansion) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4; 
+
+    Keys keys;
+    key_gen(&keys, 1024, parties, parties); 
+    std::vector<std::pair<std::string, BloomFilterParams>> encodings = {
+        {"GBF", BloomFilterParams(set_size_clients, false_positive_exponent, keys.params.p)},
+        {"OKVS", okvs_params(set_size_clients, keys.params.p, okvs_expansion)}
+    };
+
+    std::cout << "\nBenchmarking client encodings, " << parties << " parties, ";
+    std::cout << "Set size clients " << set_size_clients << ", Set size server " << set_size_server << std::endl;
+
+    for (auto& [name, params] : encodings) {
+        std::vector<long> client_prep_times;
+        std::vector<long> server_online_times;
+        std::vector<size_t> client_sent_bytes_all;
+        long failures = 0;
+
+        for (int i = 0; i < repetitions; ++i) {
+            std::vector<std::vector<long>> client_sets;
+            std::vector<long> server_set;
+            generate_clients_and_server_sets(parties - 1, set_size_clients, set_size_server, 
+                domain_size, forced_intersection_size, client_sets, server_set);
+
+            double client_prep_time = 0.0;
+            double client_online_time = 0.0;
+            double server_prep_time = 0.0;
+            double server_online_time = 0.0;
+            size_t server_sent_bytes = 0;
+            size_t server_received_bytes = 0;
+            size_t client_sent_bytes = 0;
+            size_t client_received_bytes = 0;
+
+            std::vector<long> result = multiparty_psi(client_sets, server_set, params, keys,
+                &client_prep_time, &client_online_time, &server_prep_time, &server_online_time,
+                &server_sent_bytes, &server_received_bytes, &client_sent_bytes, &client_received_bytes);
+            if (result != compute_intersection_non_private(client_sets, server_set)) 
+                failures++;
+
+            client_prep_times.push_back(static_cast<long>(client_prep_time));
+            server_online_times.push_back(static_cast<long>(server_online_time));
+            client_sent_bytes_all.push_back(client_sent_bytes);
+        }
+
+        double mean_client_prep = sample_mean_computation(client_prep_times);
+        double mean_server_online = sample_mean_computation(server_online_times);
+        double mean_client_sent = sample_mean_communication(client_sent_bytes_all);
+        std::cout << name << ": m=" << params.bin_count << ", k=" << params.seeds.size()
+                  << ", encryptions per client " << params.bin_count
+                  << ", client prep time (ms) " << std::fixed << mean_client_prep
+                  << ", server online time (ms) " << mean_server_online
+                  << ", client sent bytes " << mean_client_sent
+                  << ", wrong intersections " << failures << "/" << repetitions << std::endl;
+    }
+}
+
+void benchmark_gbf_build(long repetitions, std::vector<long> set_sizes, int false_positive_exponent) {
+    long long domain_size = (1LL << 32) - 1;
+    Keys keys;
+    key_gen(&keys, 1024, 2, 2); 
+
+    std::cout << "\nBenchmarking garbled Bloom filter construction, k=" << -false_positive_exponent << std::endl;
+    for (long set_size : set_sizes) {
+        BloomFilterParams params(set_size, false_positive_exponent, keys.params.p); 
+        std::vector<long> insert_set_times;
+        std::vector<long> build_times;
+        long mismatches = 0;
+
+        for (int i = 0; i < repetitions; ++i) {
+            std::vector<long> set = sample_set(set_size, domain_size);
+
+            GarbledBloomFilter reference(params);
+            auto start = std::chrono::high_resolution_clock::now();
+            reference.insert_set(set);
+            auto stop = std::chrono::high_resolution_clock::now();
+            insert_set_times.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+
+            GarbledBloomFilter built(params);
+            start = std::chrono::high_resolution_clock::now();
+            built.build(set);
+            stop = std::chrono::high_resolution_clock::now();
+            build_times.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+
+            for (long x : set) 
+                if (built.contains(x) != reference.contains(x)) 
+                    mismatches++;
+        }
+
+        double mean_insert_set = sample_mean_computation(insert_set_times);
+        double mean_build = sample_mean_computation(build_times);
+        std::cout << "n=" << set_size << ", m=" << params.bin_count
+                  << ": insert_set (ms) mean " << std::fixed << mean_insert_set
+                  << ", std dev " << sample_std_computation(insert_set_times, mean_insert_set)
+                  << "; build (ms) mean " << mean_build
+                  << ", std dev " << sample_std_computation(build_times, mean_build)
+                  << "; membership mismatches " << mismatches << std::endl;
+    }
 }
\ No newline at end of file
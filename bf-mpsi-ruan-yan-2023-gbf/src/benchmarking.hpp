@@ -11,4 +11,21 @@ void benchmark(
     int false_positive_exponent
 );
 
+// compares the garbled Bloom filter against the garbled cuckoo OKVS as client encoding
+void benchmark_encodings(
+    long repetitions,
+    long parties,
+    long set_size_clients,
+    long set_size_server,
+    int false_positive_exponent,
+    double okvs_expansion
+);
+
+// times GarbledBloomFilter::insert_set against the two-pass build
+void benchmark_gbf_build(
+    long repetitions,
+    std::vector<long> set_sizes,
+    int false_positive_exponent
+);
+
 #endif
\ No newline at end of file
@@ -28,6 +28,41 @@ BloomFilterParams::BloomFilterParams(size_t element_count, int64_t e_pow, ZZ p)
     this->p = p;
 }
 
+BloomFilterParams okvs_params(size_t element_count, ZZ p, double expansion) {
+    BloomFilterParams params;
+    // peeling a random 3-hypergraph succeeds w.h.p. above ~1.222 n slots,
+    // the additive slack keeps small sets from failing
+    size_t slot_count = static_cast<size_t>(std::ceil(expansion * static_cast<double>(element_count))) + 48;
+    params.segment_size = (slot_count + 2) / 3;
+    params.bin_count = 3 * params.segment_size;
+    for (int i = 0; i < 3; ++i) {
+        params.seeds.push_back(static_cast<uint64_t>(rand()) + 1);
+    }
+    params.p = p;
+    return params;
+}
+
+void redraw_params(BloomFilterParams& params, bool grow) {
+    for (auto& seed : params.seeds) {
+        seed = static_cast<uint64_t>(rand()) + 1;
+    }
+    if (!grow) 
+        return;
+    if (params.segment_size == 0) {
+        params.bin_count += params.bin_count / 10 + 1;
+    } else {
+        params.segment_size += params.segment_size / 10 + 1;
+        params.bin_count = params.seeds.size() * params.segment_size;
+    }
+}
+
+size_t bin_index(const BloomFilterParams& params, size_t element, size_t hash_index) {
+    size_t hash = hash_element(element, params.seeds[hash_index]);
+    if (params.segment_size == 0)
+        return hash % params.bin_count;
+    return hash_index * params.segment_size + hash % params.segment_size;
+}
+
 BloomFilter::BloomFilter(const BloomFilterParams& params) {
     this->seeds = params.seeds;
     this->bins.resize(params.bin_count, false);
@@ -109,6 +144,116 @@ bool GarbledBloomFilter::insert_set(const std::vector<long>& elements) {
     return true;
 }
 
+std::vector<ZZ> GarbledBloomFilter::generate_random_shares(size_t count) const {
+    // 64 extra bits per share keep the bias of the reduction below 2^-64
+    long share_bytes = NumBytes(p) + 8;
+    std::vector<unsigned char> buffer(count * share_bytes);
+    GetCurrentRandomStream().get(buffer.data(), static_cast<long>(buffer.size()));
+
+    ZZ bound = p - 1;
+    std::vector<ZZ> shares(count);
+    for (size_t i = 0; i < count; i++) {
+        ZZFromBytes(shares[i], buffer.data() + i * share_bytes, share_bytes);
+        shares[i] = shares[i] % bound + 1; // [1, p-1]
+    }
+    return shares;
+}
+
+// Montgomery's trick: one InvMod and three multiplications per value
+static void batch_invert(std::vector<ZZ>& values, const ZZ& p) {
+    if (values.empty()) 
+        return;
+    std::vector<ZZ> prefix(values.size());
+    prefix[0] = values[0];
+    for (size_t i = 1; i < values.size(); i++) 
+        prefix[i] = MulMod(prefix[i - 1], values[i], p);
+
+    ZZ inverse = InvMod(prefix.back(), p);
+    for (size_t i = values.size() - 1; i > 0; i--) {
+        ZZ value_inverse = MulMod(inverse, prefix[i - 1], p);
+        inverse = MulMod(inverse, values[i], p);
+        values[i] = value_inverse;
+    }
+    values[0] = inverse;
+}
+
+bool GarbledBloomFilter::build(const std::vector<long>& elements) {
+    size_t bin_count = bins.size();
+    size_t n = elements.size();
+
+    // First pass: distinct bins of every element, and the first free one becomes its pivot.
+    // The remaining free bins of the element are claimed for random shares.
+    std::vector<size_t> indices;
+    indices.reserve(n * seeds.size());
+    std::vector<size_t> offsets(n + 1, 0);
+    std::vector<uint64_t> occupied((bin_count + 63) / 64, 0);
+    std::vector<long> pivot_of_bin(bin_count, -1); // position of the pivot in insertion order
+    std::vector<size_t> pivots;
+    std::vector<size_t> pivot_elements;
+    pivots.reserve(n);
+    pivot_elements.reserve(n);
+    for (size_t e = 0; e < n; e++) {
+        size_t begin = indices.size();
+        long pivot = -1;
+        for (uint64_t seed : seeds) {
+            size_t j = hash_element(static_cast<size_t>(elements[e]), seed) % bin_count;
+            if (std::find(indices.begin() + begin, indices.end(), j) != indices.end()) 
+                continue;
+            indices.push_back(j);
+
+            uint64_t bit = uint64_t{1} << (j & 63);
+            if ((occupied[j >> 6] & bit) == 0) {
+                occupied[j >> 6] |= bit;
+                if (pivot == -1) 
+                    pivot = static_cast<long>(j);
+            }
+        }
+        offsets[e + 1] = indices.size();
+        if (pivot != -1) {
+            pivot_of_bin[pivot] = static_cast<long>(pivots.size());
+            pivots.push_back(static_cast<size_t>(pivot));
+            pivot_elements.push_back(e);
+        }
+    }
+
+    // Second pass: every bin that is not a pivot (including untouched ones) holds a random share
+    std::vector<ZZ> shares = generate_random_shares(bin_count - pivots.size());
+    size_t next_share = 0;
+    for (size_t j = 0; j < bin_count; j++) {
+        if (pivot_of_bin[j] == -1) 
+            bins[j] = std::move(shares[next_share++]);
+    }
+
+    // A pivot is the inverse of the product of the other bins of its element. Earlier pivots are
+    // kept as fractions num / den, so all divisions are deferred to a single batched inversion.
+    std::vector<ZZ> nums(pivots.size()), dens(pivots.size());
+    for (size_t i = 0; i < pivots.size(); i++) {
+        size_t e = pivot_elements[i];
+        ZZ num = to_ZZ(1);
+        ZZ den = to_ZZ(1);
+        for (size_t l = offsets[e]; l < offsets[e + 1]; l++) {
+            size_t j = indices[l];
+            if (j == pivots[i]) 
+                continue;
+            long other = pivot_of_bin[j];
+            if (other == -1) {
+                den = MulMod(den, bins[j], p);
+            } else {
+                num = MulMod(num, dens[other], p);
+                den = MulMod(den, nums[other], p);
+            }
+        }
+        nums[i] = num;
+        dens[i] = den;
+    }
+
+    batch_invert(dens, p);
+    for (size_t i = 0; i < pivots.size(); i++) 
+        bins[pivots[i]] = MulMod(nums[i], dens[i], p);
+
+    return pivots.size() == n;
+}
+
 bool GarbledBloomFilter::contains(const size_t& element) const {
     size_t bin_count = bins.size();
     ZZ recovered = to_ZZ(1); 
@@ -127,4 +272,90 @@ bool GarbledBloomFilter::contains(const size_t& element) const {
 
 void GarbledBloomFilter::clear() {
     std::fill(bins.begin(), bins.end(), to_ZZ(0));
+}
+
+GarbledCuckooOkvs::GarbledCuckooOkvs(const BloomFilterParams& params) {
+    this->seeds = params.seeds;
+    this->segment_size = params.segment_size;
+    this->slots.resize(params.bin_count, to_ZZ(0));
+    this->p = params.p;
+}
+
+ZZ GarbledCuckooOkvs::generate_random_share() const {
+    return RandomBnd(p - 1) + 1; // [1, p-1]
+}
+
+bool GarbledCuckooOkvs::encode(const std::vector<long>& elements) {
+    size_t n = elements.size();
+    size_t hash_count = seeds.size();
+    std::vector<size_t> edges(n * hash_count);
+    for (size_t e = 0; e < n; e++) {
+        for (size_t h = 0; h < hash_count; h++) {
+            size_t hash = hash_element(static_cast<size_t>(elements[e]), seeds[h]);
+            edges[e * hash_count + h] = h * segment_size + hash % segment_size;
+        }
+    }
+
+    // degree and xor of incident edges per slot, so a degree-1 slot names its edge directly
+    std::vector<size_t> degree(slots.size(), 0), incident(slots.size(), 0);
+    for (size_t e = 0; e < n; e++) {
+        for (size_t h = 0; h < hash_count; h++) {
+            degree[edges[e * hash_count + h]]++;
+            incident[edges[e * hash_count + h]] ^= e;
+        }
+    }
+
+    std::vector<size_t> queue;
+    for (size_t s = 0; s < slots.size(); s++) {
+        if (degree[s] == 1) 
+            queue.push_back(s);
+    }
+    std::vector<std::pair<size_t, size_t>> peeled; // (edge, pivot slot)
+    peeled.reserve(n);
+    while (!queue.empty()) {
+        size_t s = queue.back();
+        queue.pop_back();
+        if (degree[s] != 1) 
+            continue;
+        size_t e = incident[s];
+        peeled.emplace_back(e, s);
+        for (size_t h = 0; h < hash_count; h++) {
+            size_t t = edges[e * hash_count + h];
+            degree[t]--;
+            incident[t] ^= e;
+            if (degree[t] == 1) 
+                queue.push_back(t);
+        }
+    }
+
+    // back-substitution: the pivot of each edge is untouched by every edge peeled after it
+    for (size_t i = peeled.size(); i-- > 0;) {
+        auto [e, pivot] = peeled[i];
+        ZZ product = to_ZZ(1);
+        for (size_t h = 0; h < hash_count; h++) {
+            size_t t = edges[e * hash_count + h];
+            if (t == pivot) 
+                continue;
+            if (slots[t] == to_ZZ(0)) 
+                slots[t] = generate_random_share();
+            product = MulMod(product, slots[t], p);
+        }
+        slots[pivot] = InvMod(product, p);
+    }
+
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (slots[i] == to_ZZ(0)) {
+            slots[i] = generate_random_share();
+        }
+    }
+    return peeled.size() == n;
+}
+
+ZZ GarbledCuckooOkvs::decode(const size_t& element) const {
+    ZZ recovered = to_ZZ(1);
+    for (size_t h = 0; h < seeds.size(); h++) {
+        size_t j = h * segment_size + hash_element(element, seeds[h]) % segment_size;
+        recovered = MulMod(recovered, slots[j], p);
+    }
+    return recovered;
 }
\ No newline at end of file
@@ -17,9 +17,19 @@ struct BloomFilterParams {
     size_t bin_count;
     std::vector<uint64_t> seeds;
     ZZ p;
+    size_t segment_size = 0; // > 0 selects the garbled cuckoo OKVS layout (one segment per hash)
+    BloomFilterParams() = default;
     BloomFilterParams(size_t element_count, int64_t e_pow, ZZ p);
 };
 
+// 3-hash garbled cuckoo layout with about expansion * n slots
+BloomFilterParams okvs_params(size_t element_count, ZZ p, double expansion = 1.3);
+// fresh seeds for every hash function, and about 10% more bins if grow is set
+void redraw_params(BloomFilterParams& params, bool grow);
+
+// bin of the element for the given hash function, under either layout
+size_t bin_index(const BloomFilterParams& params, size_t element, size_t hash_index);
+
 struct BloomFilter {
     std::vector<bool> bins;  // m bins
     std::vector<uint64_t> seeds; // k hash functions
@@ -46,9 +56,30 @@ struct GarbledBloomFilter {
     explicit GarbledBloomFilter(const BloomFilterParams& params);
     
     bool insert_set(const std::vector<long>& elements); // returns false if the element cannot be inserted
+    // same encoding as insert_set, built in two passes: slot assignment on an occupancy bitmap,
+    // then bulk random shares and one batched inversion for all final slots
+    bool build(const std::vector<long>& elements);
     void clear();
     bool contains(const size_t& element) const;
 
+    ZZ generate_random_share() const;
+    std::vector<ZZ> generate_random_shares(size_t count) const;
+};
+
+// Oblivious key-value store: every element of the set maps to one slot per segment,
+// and the product of its slots is 1 mod p. Encoding peels the 3-hypergraph.
+struct GarbledCuckooOkvs {
+    std::vector<ZZ> slots;
+    std::vector<uint64_t> seeds;
+    size_t segment_size;
+    ZZ p;
+
+    explicit GarbledCuckooOkvs(const BloomFilterParams& params);
+
+    bool encode(const std::vector<long>& elements); // returns false if the hypergraph has a 2-core
+    ZZ decode(const size_t& element) const;
+    bool contains(const size_t& element) const { return decode(element) == to_ZZ(1); }
+
     ZZ generate_random_share() const;
 };
 
@@ -33,5 +33,7 @@ int main() {
     );
 
     benchmark(10, {2, 5, 10, 20, 30, 40, 50, 100}, 256, 1024, -30);
+    benchmark_encodings(10, 3, 256, 1024, -30, 1.3);
+    benchmark_gbf_build(5, {1 << 10, 1 << 12, 1 << 14, 1 << 16}, -30);
     return 0;
 }
\ No newline at end of file
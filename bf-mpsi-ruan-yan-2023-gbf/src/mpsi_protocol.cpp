@@ -1,10 +1,122 @@
 #include "mpsi_protocol.hpp"
 #include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+// Attempts before the clients give up on encoding, every retry after the first also grows the table
+const int MAX_ENCODING_ATTEMPTS = 8;
 
 size_t get_ciphertext_size(const Ciphertext& ct) {
     return NumBytes(ct.c1) + NumBytes(ct.c2);
 }
 
+// Fails if an element could not be placed (a 2-core left after peeling, or no free
+// GBF bin) or if any element of the set does not decode to 1
+bool encode_set(const std::vector<long>& elements, 
+                const BloomFilterParams& bf_params, 
+                std::vector<ZZ>& bins) {
+    // A repeated element would need two pivots for the same bins and can never be placed
+    std::vector<long> set = elements;
+    std::sort(set.begin(), set.end());
+    set.erase(std::unique(set.begin(), set.end()), set.end());
+
+    bool encoded = true;
+    if (bf_params.segment_size > 0) {
+        GarbledCuckooOkvs okvs(bf_params);
+        encoded = okvs.encode(set);
+        for (size_t i = 0; i < set.size() && encoded; i++) 
+            encoded = okvs.contains(static_cast<size_t>(set[i]));
+        bins = std::move(okvs.slots);
+    } else {
+        GarbledBloomFilter gbf(bf_params);
+        encoded = gbf.build(set);
+        for (size_t i = 0; i < set.size() && encoded; i++) 
+            encoded = gbf.contains(static_cast<size_t>(set[i]));
+        bins = std::move(gbf.bins);
+    }
+    return encoded;
+}
+
+std::vector<Ciphertext> compute_erbf(const std::vector<ZZ>& bins, 
+                                    const BloomFilterParams& bf_params, 
+                                    const Keys& keys) {
+    std::vector<Ciphertext> erbf;
+    erbf.reserve(bf_params.bin_count);
+    for (size_t l = 0; l < bf_params.bin_count; l++) 
+        erbf.push_back(encrypt(bins[l], keys.params));
+    return erbf;
+}
+
+void set_blinding(const std::vector<long>& set, 
+                const Keys& keys, 
+                std::vector<ZZ>& r_js, 
+                std::vector<Ciphertext>& w_js) {
+    for (long x : set) {
+        ZZ r = RandomBnd(keys.params.p - 1) + 1;
+        r_js.push_back(r);
+        // Enc(x + 1) * Enc(r) = Enc((x + 1) * r), so a single encryption suffices
+        ZZ blinded = MulMod(to_ZZ(x + 1), r, keys.params.p); // avoid encrypting 0
+        w_js.push_back(encrypt(blinded, keys.params));
+    }
+}
+
+std::vector<Ciphertext> aggregate_ciphertexts(const std::vector<long>& server_set, 
+                        const std::vector<std::vector<Ciphertext>>& clients_erbfs, 
+                        const std::vector<Ciphertext>& w_js,
+                        const BloomFilterParams& bf_params,
+                        const Keys& keys) {
+    std::vector<Ciphertext> combined_ciphertexts;
+    combined_ciphertexts.reserve(server_set.size());
+    for (long j = 0; j < server_set.size(); j++) {
+        Ciphertext c_j = w_js[j];
+        for (const auto& erbf : clients_erbfs) {
+            std::unordered_set<size_t> visited_bins;
+            for (size_t h = 0; h < bf_params.seeds.size(); h++) {
+                size_t idx = bin_index(bf_params, server_set[j], h);
+                if (visited_bins.count(idx) > 0) 
+                    continue;
+                visited_bins.insert(idx);
+                c_j.c1 = MulMod(c_j.c1, erbf[idx].c1, keys.params.p);
+                c_j.c2 = MulMod(c_j.c2, erbf[idx].c2, keys.params.p);
+            }
+        }
+        combined_ciphertexts.push_back(c_j);
+    }
+    return combined_ciphertexts;
+}
+
+std::vector<ZZ> compute_decryption_shares(const std::vector<ZZ>& combined_ciphertexts_c1, 
+                            const ZZ& key_share,
+                            const ZZ& p,
+                            const ZZ& q,
+                            int i,
+                            int total_parties) {
+    ZZ delta = compute_delta(i + 1, total_parties, q);
+    std::vector<ZZ> shares;
+    shares.reserve(combined_ciphertexts_c1.size());
+    for (const auto& c1 : combined_ciphertexts_c1) 
+        shares.push_back(compute_share(c1, key_share, delta, p));
+    return shares;
+}
+
+std::vector<long> decrypt_intersection(const std::vector<std::vector<ZZ>>& decryption_shares, 
+                                    const std::vector<Ciphertext>& combined_ciphertexts,
+                                    const std::vector<long>& server_set,
+                                    const std::vector<ZZ>& r_js,
+                                    const int total_parties,
+                                    const Keys& keys) {
+    std::vector<long> intersection;
+    for (long j = 0; j < server_set.size(); j++) {
+        ZZ combined_shares = to_ZZ(1);
+        for (int i = 0; i < total_parties; i++) 
+            combined_shares = MulMod(combined_shares, decryption_shares[i][j], keys.params.p);
+        ZZ decrypted = MulMod(combined_ciphertexts[j].c2, InvMod(combined_shares, keys.params.p), keys.params.p);
+        if (decrypted == MulMod(to_ZZ(server_set[j] + 1), r_js[j], keys.params.p)) 
+            intersection.push_back(server_set[j]);
+    }
+    return intersection;
+}
+
 std::vector<long> multiparty_psi(
     const std::vector<std::vector<long>>& client_sets,
     const std::vector<long>& server_set,
@@ -24,26 +136,31 @@ std::vector<long> multiparty_psi(
     int total_parties = n_clients + 1; 
 
     // Initialization stage
+    // The hash seeds are shared, so if any client fails to encode its set, all parties
+    // agree on redrawn params and every client encodes again
     auto start = high_resolution_clock::now();
-    size_t all_erbfs_size_bytes = 0;
-    std::vector<std::vector<Ciphertext>> all_erbfs;
-    for (const auto& set : client_sets) {
-        GarbledBloomFilter gbf(bf_params);
-        gbf.insert_set(set);
-
-        std::vector<Ciphertext> erbf;
-        size_t erbf_size_bytes = 0;
-        for (size_t l = 0; l < bf_params.bin_count; l++) {
-            Ciphertext ciphertext = encrypt(gbf.bins[l], keys.params);
-            erbf.push_back(ciphertext);
-            erbf_size_bytes += get_ciphertext_size(ciphertext);
-        }
-        all_erbfs.push_back(erbf);
-        all_erbfs_size_bytes += erbf_size_bytes;
+    std::vector<std::vector<ZZ>> all_bins(n_clients);
+    for (int attempt = 1; ; attempt++) {
+        bool encoded = true;
+        for (int i = 0; i < n_clients && encoded; i++) 
+            encoded = encode_set(client_sets[i], bf_params, all_bins[i]);
+        if (encoded) 
+            break;
+        if (attempt == MAX_ENCODING_ATTEMPTS) 
+            throw std::runtime_error("Clients could not encode their sets under any drawn params");
+        redraw_params(bf_params, attempt > 1);
     }
+    std::vector<std::vector<Ciphertext>> all_erbfs;
+    for (const auto& bins : all_bins) 
+        all_erbfs.push_back(compute_erbf(bins, bf_params, keys));
     auto stop = high_resolution_clock::now();
     *client_prep_time = duration<double, std::milli>(stop - start).count() / n_clients;
+
     // Clients send ERBFs to server
+    size_t all_erbfs_size_bytes = 0;
+    for (const auto& erbf : all_erbfs) 
+        for (const auto& ct : erbf) 
+            all_erbfs_size_bytes += get_ciphertext_size(ct);
     *client_sent_bytes += all_erbfs_size_bytes / n_clients;
     *server_received_bytes += all_erbfs_size_bytes;
 
@@ -51,74 +168,62 @@ std::vector<long> multiparty_psi(
     start = high_resolution_clock::now();
     std::vector<ZZ> r_js;
     std::vector<Ciphertext> w_js;
-    for (long x : server_set) {
-        ZZ r = RandomBnd(keys.params.p - 1) + 1;
-        r_js.push_back(r);
-        Ciphertext enc_x = encrypt(to_ZZ(x + 1), keys.params); // avoid encrypting 0
-        Ciphertext enc_r = encrypt(r, keys.params);
-        w_js.push_back({MulMod(enc_x.c1, enc_r.c1, keys.params.p), 
-                        MulMod(enc_x.c2, enc_r.c2, keys.params.p)});
-    }
+    set_blinding(server_set, keys, r_js, w_js);
     stop = high_resolution_clock::now();
     *server_prep_time = duration<double, std::milli>(stop - start).count();
 
     // Online stage
-    ZZ q = (keys.params.p - 1) / 2;
-    std::vector<long> result;
-    for (long j = 0; j < server_set.size(); j++) {
-        start = high_resolution_clock::now();
-        Ciphertext c_j = w_js[j];
-        for (const auto& erbf : all_erbfs) {
-            std::unordered_set<size_t> visited_bins;
-            for (uint64_t seed : bf_params.seeds) {
-                size_t idx = hash_element(server_set[j], seed) % bf_params.bin_count;
-                if (visited_bins.count(idx) > 0) 
-                    continue;
-                visited_bins.insert(idx);
-                c_j.c1 = MulMod(c_j.c1, erbf[idx].c1, keys.params.p);
-                c_j.c2 = MulMod(c_j.c2, erbf[idx].c2, keys.params.p);
-            }
-        }
-        stop = high_resolution_clock::now();
-        *server_online_time += duration<double, std::milli>(stop - start).count();
-        // Server sends c_j to all clients
-        *server_sent_bytes += get_ciphertext_size(c_j) * n_clients;
-        *client_received_bytes += get_ciphertext_size(c_j);
+    // Server aggregates the ciphertexts of all its elements
+    start = high_resolution_clock::now();
+    std::vector<Ciphertext> combined_ciphertexts = aggregate_ciphertexts(server_set, 
+                                                                        all_erbfs, w_js, 
+                                                                        bf_params, keys);
+    stop = high_resolution_clock::now();
+    *server_online_time += duration<double, std::milli>(stop - start).count();
 
-        ZZ combined_shares = to_ZZ(1);
-        double current_item_client_time_sum = 0.0;
-        size_t all_shares_size_bytes = 0;
-        for (int i = 1; i <= total_parties; i++) {
-            start = high_resolution_clock::now();
-            ZZ delta = compute_delta(i, total_parties, q);
-            // i-1 since the vector is 0-indexed, but 'delta' uses 1-indexing
-            ZZ share = compute_share(c_j.c1, keys.key_shares[i-1], delta, keys.params.p);
-            stop = high_resolution_clock::now();
-            double share_time = duration<double, std::milli>(stop - start).count();
-
-            if (i <= n_clients) {
-                current_item_client_time_sum += share_time;
-                // Client sends share to server
-                all_shares_size_bytes += NumBytes(share);
-            } else 
-                *server_online_time += share_time;
-
-            start = high_resolution_clock::now();
-            combined_shares = MulMod(combined_shares, share, keys.params.p);
-            stop = high_resolution_clock::now();
-            *server_online_time += duration<double, std::milli>(stop - start).count();
-        }
-        *client_online_time += current_item_client_time_sum / n_clients;
-        *client_sent_bytes += all_shares_size_bytes / n_clients;
-        *server_received_bytes += all_shares_size_bytes;
-        
-        start = high_resolution_clock::now();
-        ZZ decrypted = MulMod(c_j.c2, InvMod(combined_shares, keys.params.p), keys.params.p);
-        if (decrypted == MulMod(to_ZZ(server_set[j] + 1), r_js[j], keys.params.p)) {
-            result.push_back(server_set[j]);
-        }
-        stop = high_resolution_clock::now();
-        *server_online_time += duration<double, std::milli>(stop - start).count();
+    // Server broadcasts all c1's in a single message
+    std::vector<ZZ> combined_ciphertexts_c1;
+    combined_ciphertexts_c1.reserve(combined_ciphertexts.size());
+    size_t combined_ciphertexts_size_bytes = 0;
+    for (const auto& ct : combined_ciphertexts) {  
+        combined_ciphertexts_c1.push_back(ct.c1);
+        combined_ciphertexts_size_bytes += NumBytes(ct.c1);
     }
-    return result;
+    *server_sent_bytes += combined_ciphertexts_size_bytes * n_clients;
+    *client_received_bytes += combined_ciphertexts_size_bytes;
+
+    // Each party computes its vector of decryption shares (the server holds the last key share)
+    ZZ q = (keys.params.p - 1) / 2;
+    std::vector<std::vector<ZZ>> decryption_shares(total_parties);
+    start = high_resolution_clock::now();
+    for (int i = 0; i < n_clients; i++) 
+        decryption_shares[i] = compute_decryption_shares(combined_ciphertexts_c1, keys.key_shares[i], 
+                                                         keys.params.p, q, i, total_parties);
+    stop = high_resolution_clock::now();
+    *client_online_time += duration<double, std::milli>(stop - start).count() / n_clients;
+
+    start = high_resolution_clock::now();
+    decryption_shares[n_clients] = compute_decryption_shares(combined_ciphertexts_c1, keys.key_shares[n_clients], 
+                                                             keys.params.p, q, n_clients, total_parties);
+    stop = high_resolution_clock::now();
+    *server_online_time += duration<double, std::milli>(stop - start).count();
+
+    // Clients send their share vectors to the server in a single message
+    size_t all_shares_size_bytes = 0;
+    for (int i = 0; i < n_clients; i++) 
+        for (const auto& share : decryption_shares[i]) 
+            all_shares_size_bytes += NumBytes(share);
+    *client_sent_bytes += all_shares_size_bytes / n_clients;    
+    *server_received_bytes += all_shares_size_bytes;
+
+    // Server combines shares and decrypts
+    start = high_resolution_clock::now();
+    std::vector<long> intersection = decrypt_intersection(decryption_shares, 
+                                                        combined_ciphertexts,
+                                                        server_set, r_js,
+                                                        total_parties, keys);
+    stop = high_resolution_clock::now();
+    *server_online_time += duration<double, std::milli>(stop - start).count();
+
+    return intersection;
 }
\ No newline at end of file
@@ -9,6 +9,12 @@
 #include <fstream>
 #include <filesystem>
 #include "mpsi_protocol.hpp" 
+#include "erbf_cache.hpp"
+#include "blinding_store.hpp"
+#include "query_service.hpp"
+#include "sharding.hpp"
+#include <thread>
+#include <future>
 #include "experiments.hpp"
 
 // https://github.com/jellevos/bitset_mpsi/blob/master/main.cpp
@@ -68,6 +74,14 @@ double sample_std_communication(const std::vector<size_t>& measurements, double
     return std::sqrt(sum / (measurements.size() - 1.0));
 }
 
+// Nearest-rank percentile
+double sample_percentile(std::vector<long> measurements, double percentile) {
+    if (measurements.empty()) return 0.0;
+    std::sort(measurements.begin(), measurements.end());
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * measurements.size()));
+    return measurements[std::clamp<size_t>(rank, 1, measurements.size()) - 1];
+}
+
 void generate_clients_and_server_sets(
     long n_clients,
     size_t set_size_clients,
@@ -282,4 +296,844 @@ void benchmark(long repetitions, std::vector<long> number_of_parties_list, long
             << time_network_2 << "," 
             << time_network_3 << "\n";
     }
+}
+
+void benchmark_concurrent(long repetitions, std::vector<long> number_of_parties_list, long set_size_clients, long set_size_server, 
+                          int false_positive_exponent, const SimulationConfig& config) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream conc_csv("../data/concurrent.csv");
+    conc_csv << "Parties,Client Prep,Client Online,Server Prep,Server Online,Slowest Party,Critical Path\n";
+    std::ofstream wall_csv("../data/party_wall_times.csv");
+    wall_csv << "Parties,Repetition,Party,Wall Time\n";
+
+    for (long t : number_of_parties_list) {
+        BloomFilterParams params(set_size_clients, false_positive_exponent); 
+        Keys keys;
+        // threshold t, parties n = t.
+        key_gen(&keys, 1024, t, t); 
+
+        std::cout << "\nBenchmarking " << t << " concurrent parties" << (config.pin_cores ? " (pinned)" : "") << ", ";
+        std::cout << "Set size clients " << set_size_clients << ", Set size server " << set_size_server;
+        std::cout << ", Params: m=" << params.bin_count << ", k=" << params.seeds.size() << std::endl;
+
+        std::vector<long> client_prep_times;
+        std::vector<long> client_online_times;
+        std::vector<long> server_prep_times;
+        std::vector<long> server_online_times;
+        std::vector<long> slowest_party_times;
+        std::vector<long> critical_path_times;
+
+        for (int i = 0; i < repetitions; ++i) {
+            std::vector<std::vector<long>> client_sets;
+            std::vector<long> server_set;
+            generate_clients_and_server_sets(t - 1, set_size_clients, set_size_server, 
+                domain_size, forced_intersection_size, client_sets, server_set);
+
+            double client_prep_time = 0.0;
+            double client_online_time = 0.0;
+            double server_prep_time = 0.0;
+            double server_online_time = 0.0;
+            size_t server_sent_bytes = 0;
+            size_t server_received_bytes = 0;
+            size_t client_sent_bytes = 0;
+            size_t client_received_bytes = 0;
+            std::vector<double> party_wall_times;
+            double critical_path_time = 0.0;
+
+            std::vector<long> result = multiparty_psi_concurrent(
+                client_sets, 
+                server_set, 
+                params, 
+                keys,
+                config,
+                &client_prep_time,
+                &client_online_time,
+                &server_prep_time,
+                &server_online_time,
+                &server_sent_bytes,
+                &server_received_bytes,
+                &client_sent_bytes,
+                &client_received_bytes,
+                &party_wall_times,
+                &critical_path_time
+            );
+
+            std::vector<long> expected = compute_intersection_non_private(client_sets, server_set);
+            std::cout << "Expected size: " << expected.size() << ", MPSI size: " << result.size() << std::endl;
+
+            for (size_t party = 0; party < party_wall_times.size(); party++) 
+                wall_csv << t << "," << i << "," << party << "," << party_wall_times[party] << "\n";
+
+            client_prep_times.push_back(static_cast<long>(client_prep_time));
+            client_online_times.push_back(static_cast<long>(client_online_time));
+            server_prep_times.push_back(static_cast<long>(server_prep_time));
+            server_online_times.push_back(static_cast<long>(server_online_time));
+            slowest_party_times.push_back(static_cast<long>(*std::max_element(party_wall_times.begin(), party_wall_times.end())));
+            critical_path_times.push_back(static_cast<long>(critical_path_time));
+        }
+
+        double mean_client_prep = sample_mean_computation(client_prep_times);
+        double std_dev = sample_std_computation(client_prep_times, mean_client_prep);
+        std::cout << "Client prep time (ms): mean " << std::fixed << mean_client_prep << ", std dev " << std_dev << std::endl;
+
+        double mean_client_online = sample_mean_computation(client_online_times);
+        std_dev = sample_std_computation(client_online_times, mean_client_online);
+        std::cout << "Client online time (ms): mean " << std::fixed << mean_client_online << ", std dev " << std_dev << std::endl;
+
+        double mean_server_prep = sample_mean_computation(server_prep_times);
+        std_dev = sample_std_computation(server_prep_times, mean_server_prep);
+        std::cout << "Server prep time (ms): mean " << std::fixed << mean_server_prep << ", std dev " << std_dev << std::endl;
+
+        double mean_server_online = sample_mean_computation(server_online_times);
+        std_dev = sample_std_computation(server_online_times, mean_server_online);
+        std::cout << "Server online time (ms): mean " << std::fixed << mean_server_online << ", std dev " << std_dev << std::endl;
+
+        double mean_slowest_party = sample_mean_computation(slowest_party_times);
+        std_dev = sample_std_computation(slowest_party_times, mean_slowest_party);
+        std::cout << "Slowest party wall time (ms): mean " << std::fixed << mean_slowest_party << ", std dev " << std_dev << std::endl;
+
+        double mean_critical_path = sample_mean_computation(critical_path_times);
+        std_dev = sample_std_computation(critical_path_times, mean_critical_path);
+        std::cout << "Critical path (ms): mean " << std::fixed << mean_critical_path << ", std dev " << std_dev << std::endl;
+
+        conc_csv << t << "," 
+                << mean_client_prep << ","  
+                << mean_client_online << "," 
+                << mean_server_prep << "," 
+                << mean_server_online << ","
+                << mean_slowest_party << ","
+                << mean_critical_path << "\n";
+    }
+}
+
+void benchmark_stragglers(long repetitions, std::vector<long> number_of_parties_list, long set_size_clients, long set_size_server, 
+                          int false_positive_exponent, double threshold_fraction, long slow_parties, double slow_party_delay_ms) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream tail_csv("../data/tail_latency.csv");
+    tail_csv << "Parties,Threshold,Slow Parties,All P50,All P99,First-t P50,First-t P99\n";
+
+    for (long t : number_of_parties_list) {
+        // the server's share is always available, so at least one client share is needed
+        long threshold = std::max(2L, static_cast<long>(std::ceil(threshold_fraction * t)));
+        long slow = std::min(slow_parties, t - 1);
+
+        BloomFilterParams params(set_size_clients, false_positive_exponent); 
+        Keys keys;
+        // threshold t of n parties
+        key_gen(&keys, 1024, threshold, t); 
+
+        std::cout << "\nBenchmarking " << t << " parties, threshold " << threshold;
+        std::cout << ", " << slow << " slow parties (+" << slow_party_delay_ms << " ms)" << std::endl;
+
+        std::vector<long> all_session_times;
+        std::vector<long> first_t_session_times;
+        for (int i = 0; i < repetitions; ++i) {
+            std::vector<std::vector<long>> client_sets;
+            std::vector<long> server_set;
+            generate_clients_and_server_sets(t - 1, set_size_clients, set_size_server, 
+                domain_size, forced_intersection_size, client_sets, server_set);
+
+            // Pick the slow clients of this session
+            std::vector<long> clients(t - 1);
+            for (long c = 0; c < t - 1; c++) 
+                clients[c] = c;
+            std::shuffle(clients.begin(), clients.end(), std::default_random_engine(rand()));
+            SimulationConfig config;
+            config.injected_delays_ms.assign(t - 1, 0.0);
+            for (long c = 0; c < slow; c++) 
+                config.injected_delays_ms[clients[c]] = slow_party_delay_ms;
+
+            for (bool first_t : {false, true}) {
+                config.first_t_responders = first_t;
+                double client_prep_time = 0.0;
+                double client_online_time = 0.0;
+                double server_prep_time = 0.0;
+                double server_online_time = 0.0;
+                size_t server_sent_bytes = 0;
+                size_t server_received_bytes = 0;
+                size_t client_sent_bytes = 0;
+                size_t client_received_bytes = 0;
+                std::vector<double> party_wall_times;
+                double critical_path_time = 0.0;
+
+                std::vector<long> result = multiparty_psi_concurrent(
+                    client_sets, 
+                    server_set, 
+                    params, 
+                    keys,
+                    config,
+                    &client_prep_time,
+                    &client_online_time,
+                    &server_prep_time,
+                    &server_online_time,
+                    &server_sent_bytes,
+                    &server_received_bytes,
+                    &client_sent_bytes,
+                    &client_received_bytes,
+                    &party_wall_times,
+                    &critical_path_time
+                );
+
+                std::vector<long> expected = compute_intersection_non_private(client_sets, server_set);
+                std::cout << (first_t ? "First-t: " : "All:     ");
+                std::cout << "Expected size: " << expected.size() << ", MPSI size: " << result.size();
+                std::cout << ", Session time: " << critical_path_time << " ms" << std::endl;
+
+                if (first_t) 
+                    first_t_session_times.push_back(static_cast<long>(critical_path_time));
+                else 
+                    all_session_times.push_back(static_cast<long>(critical_path_time));
+            }
+        }
+
+        double all_p50 = sample_percentile(all_session_times, 50);
+        double all_p99 = sample_percentile(all_session_times, 99);
+        double first_t_p50 = sample_percentile(first_t_session_times, 50);
+        double first_t_p99 = sample_percentile(first_t_session_times, 99);
+        std::cout << "Session time, waiting for all parties (ms): p50 " << std::fixed << all_p50 << ", p99 " << all_p99 << std::endl;
+        std::cout << "Session time, first " << threshold << " responders (ms): p50 " << std::fixed << first_t_p50 << ", p99 " << first_t_p99 << std::endl;
+
+        tail_csv << t << "," 
+                << threshold << ","
+                << slow << ","
+                << all_p50 << ","  
+                << all_p99 << "," 
+                << first_t_p50 << "," 
+                << first_t_p99 << "\n";
+    }
+}
+
+void benchmark_erbf_cache(long repetitions, std::vector<long> number_of_parties_list, long set_size_clients, long set_size_server, 
+                          int false_positive_exponent, const std::string& cache_directory) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream cache_csv("../data/erbf_cache.csv");
+    cache_csv << "Parties,Cold Client Prep,Warm Client Prep,Warm Rerandomized Client Prep,Warm Total,Cold Total\n";
+
+    for (long t : number_of_parties_list) {
+        BloomFilterParams params(set_size_clients, false_positive_exponent); 
+        Keys keys;
+        key_gen(&keys, 1024, t, t); 
+
+        std::cout << "\nBenchmarking ERBF cache with " << t << " parties" << std::endl;
+
+        std::vector<long> cold_prep_times, warm_prep_times, rerandomized_prep_times;
+        std::vector<long> cold_total_times, warm_total_times;
+        for (int i = 0; i < repetitions; ++i) {
+            std::vector<std::vector<long>> client_sets;
+            std::vector<long> server_set;
+            generate_clients_and_server_sets(t - 1, set_size_clients, set_size_server, 
+                domain_size, forced_intersection_size, client_sets, server_set);
+
+            // Fresh cache per repetition, so the first run is always cold
+            std::filesystem::remove_all(cache_directory);
+            ErbfCache cache(cache_directory);
+
+            // cold: build and store, warm: load, rerandomized: load and re-randomize
+            for (int run = 0; run < 3; run++) {
+                cache.rerandomize = run == 2;
+                double client_prep_time = 0.0;
+                double client_online_time = 0.0;
+                double server_prep_time = 0.0;
+                double server_online_time = 0.0;
+                size_t server_sent_bytes = 0;
+                size_t server_received_bytes = 0;
+                size_t client_sent_bytes = 0;
+                size_t client_received_bytes = 0;
+
+                std::vector<long> result = multiparty_psi(
+                    client_sets, 
+                    server_set, 
+                    params, 
+                    keys,
+                    &client_prep_time,
+                    &client_online_time,
+                    &server_prep_time,
+                    &server_online_time,
+                    &server_sent_bytes,
+                    &server_received_bytes,
+                    &client_sent_bytes,
+                    &client_received_bytes,
+                    &cache
+                );
+
+                std::vector<long> expected = compute_intersection_non_private(client_sets, server_set);
+                std::cout << (run == 0 ? "Cold:         " : run == 1 ? "Warm:         " : "Rerandomized: ");
+                std::cout << "Expected size: " << expected.size() << ", MPSI size: " << result.size();
+                std::cout << ", Client prep: " << client_prep_time << " ms" << std::endl;
+
+                double total_time = client_prep_time + client_online_time + server_prep_time + server_online_time;
+                if (run == 0) {
+                    cold_prep_times.push_back(static_cast<long>(client_prep_time));
+                    cold_total_times.push_back(static_cast<long>(total_time));
+                } else if (run == 1) {
+                    warm_prep_times.push_back(static_cast<long>(client_prep_time));
+                    warm_total_times.push_back(static_cast<long>(total_time));
+                } else {
+                    rerandomized_prep_times.push_back(static_cast<long>(client_prep_time));
+                }
+            }
+        }
+        std::filesystem::remove_all(cache_directory);
+
+        cache_csv << t << "," 
+                << sample_mean_computation(cold_prep_times) << ","
+                << sample_mean_computation(warm_prep_times) << ","
+                << sample_mean_computation(rerandomized_prep_times) << ","
+                << sample_mean_computation(warm_total_times) << ","
+                << sample_mean_computation(cold_total_times) << "\n";
+    }
+}
+
+void benchmark_blinding_store(long repetitions, long number_of_parties, long set_size_clients, std::vector<long> set_sizes_server, 
+                              int false_positive_exponent, const std::string& store_directory, size_t worker_count) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream store_csv("../data/blinding_store.csv");
+    store_csv << "Server Set Size,Inline Server Prep,Inline Server Prep Std,Stored Server Prep,Stored Server Prep Std,Background Prep\n";
+
+    BloomFilterParams params(set_size_clients, false_positive_exponent); 
+    Keys keys;
+    key_gen(&keys, 1024, number_of_parties, number_of_parties); 
+
+    std::filesystem::remove_all(store_directory);
+    BlindingStore store(store_directory, worker_count);
+
+    for (long set_size_server : set_sizes_server) {
+        std::cout << "\nBenchmarking blinding store with " << set_size_server << " server elements" << std::endl;
+
+        std::vector<long> inline_prep_times, stored_prep_times, background_prep_times;
+        for (int i = 0; i < repetitions; ++i) {
+            std::vector<std::vector<long>> client_sets;
+            std::vector<long> server_set;
+            generate_clients_and_server_sets(number_of_parties - 1, set_size_clients, set_size_server, 
+                domain_size, forced_intersection_size, client_sets, server_set);
+
+            // The server set is announced ahead of the query and blinded in the background
+            auto start = std::chrono::high_resolution_clock::now();
+            store.prepare(server_set, keys.params);
+            store.wait_idle();
+            auto stop = std::chrono::high_resolution_clock::now();
+            background_prep_times.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+
+            for (bool stored : {false, true}) {
+                double client_prep_time = 0.0;
+                double client_online_time = 0.0;
+                double server_prep_time = 0.0;
+                double server_online_time = 0.0;
+                size_t server_sent_bytes = 0;
+                size_t server_received_bytes = 0;
+                size_t client_sent_bytes = 0;
+                size_t client_received_bytes = 0;
+
+                std::vector<long> result = multiparty_psi(
+                    client_sets, 
+                    server_set, 
+                    params, 
+                    keys,
+                    &client_prep_time,
+                    &client_online_time,
+                    &server_prep_time,
+                    &server_online_time,
+                    &server_sent_bytes,
+                    &server_received_bytes,
+                    &client_sent_bytes,
+                    &client_received_bytes,
+                    nullptr,
+                    stored ? &store : nullptr
+                );
+
+                std::vector<long> expected = compute_intersection_non_private(client_sets, server_set);
+                std::cout << (stored ? "Stored: " : "Inline: ");
+                std::cout << "Expected size: " << expected.size() << ", MPSI size: " << result.size();
+                std::cout << ", Server prep: " << server_prep_time << " ms" << std::endl;
+
+                if (stored) 
+                    stored_prep_times.push_back(static_cast<long>(server_prep_time));
+                else 
+                    inline_prep_times.push_back(static_cast<long>(server_prep_time));
+            }
+        }
+
+        double inline_mean = sample_mean_computation(inline_prep_times);
+        double stored_mean = sample_mean_computation(stored_prep_times);
+        store_csv << set_size_server << "," 
+                << inline_mean << ","
+                << sample_std_computation(inline_prep_times, inline_mean) << ","
+                << stored_mean << ","
+                << sample_std_computation(stored_prep_times, stored_mean) << ","
+                << sample_mean_computation(background_prep_times) << "\n";
+    }
+    std::filesystem::remove_all(store_directory);
+}
+
+void benchmark_batch(long repetitions, std::vector<long> number_of_parties_list, long set_size_clients, long set_size_server, 
+                     int false_positive_exponent, std::vector<long> batch_sizes) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream batch_csv("../data/batch_queries.csv");
+    batch_csv << "Parties,Batch Size,Sequential Total,Batched Total,Sequential Bytes,Batched Bytes\n";
+    std::ofstream queries_csv("../data/batch_query_breakdown.csv");
+    queries_csv << "Parties,Batch Size,Query,Server Prep,Server Online,Client Online,Server Sent,Server Received,Client Sent,Client Received\n";
+
+    for (long t : number_of_parties_list) {
+        BloomFilterParams params(set_size_clients, false_positive_exponent); 
+        Keys keys;
+        key_gen(&keys, 1024, t, t); 
+
+        for (long batch_size : batch_sizes) {
+            std::cout << "\nBenchmarking " << t << " parties, batches of " << batch_size << " queries" << std::endl;
+
+            std::vector<long> sequential_times, batched_times;
+            std::vector<size_t> sequential_bytes, batched_bytes;
+            std::vector<QueryMetrics> mean_metrics(batch_size);
+            for (int i = 0; i < repetitions; ++i) {
+                std::vector<std::vector<long>> client_sets;
+                std::vector<std::vector<long>> server_sets(batch_size);
+                generate_clients_and_server_sets(t - 1, set_size_clients, set_size_server, 
+                    domain_size, forced_intersection_size, client_sets, server_sets[0]);
+                for (long k = 1; k < batch_size; k++) {
+                    server_sets[k] = sample_set(set_size_server, domain_size);
+                    std::sort(server_sets[k].begin(), server_sets[k].end());
+                }
+
+                // One multiparty_psi session per server set
+                double sequential_time = 0.0;
+                size_t sequential_session_bytes = 0;
+                for (const auto& server_set : server_sets) {
+                    double client_prep_time = 0.0;
+                    double client_online_time = 0.0;
+                    double server_prep_time = 0.0;
+                    double server_online_time = 0.0;
+                    size_t server_sent_bytes = 0;
+                    size_t server_received_bytes = 0;
+                    size_t client_sent_bytes = 0;
+                    size_t client_received_bytes = 0;
+
+                    multiparty_psi(
+                        client_sets, 
+                        server_set, 
+                        params, 
+                        keys,
+                        &client_prep_time,
+                        &client_online_time,
+                        &server_prep_time,
+                        &server_online_time,
+                        &server_sent_bytes,
+                        &server_received_bytes,
+                        &client_sent_bytes,
+                        &client_received_bytes
+                    );
+                    sequential_time += client_prep_time + client_online_time + server_prep_time + server_online_time;
+                    sequential_session_bytes += server_sent_bytes + server_received_bytes;
+                }
+
+                // All server sets in one batched session
+                double client_prep_time = 0.0;
+                size_t client_erbf_sent_bytes = 0;
+                size_t server_erbf_received_bytes = 0;
+                std::vector<QueryMetrics> query_metrics;
+                std::vector<std::vector<long>> results = multiparty_psi_batch(
+                    client_sets, 
+                    server_sets, 
+                    params, 
+                    keys,
+                    &client_prep_time,
+                    &client_erbf_sent_bytes,
+                    &server_erbf_received_bytes,
+                    &query_metrics
+                );
+
+                double batched_time = client_prep_time;
+                size_t batched_session_bytes = server_erbf_received_bytes;
+                for (long k = 0; k < batch_size; k++) {
+                    const QueryMetrics& m = query_metrics[k];
+                    batched_time += m.server_prep_time + m.server_online_time + m.client_online_time;
+                    batched_session_bytes += m.server_sent_bytes + m.server_received_bytes;
+
+                    mean_metrics[k].server_prep_time += m.server_prep_time / repetitions;
+                    mean_metrics[k].server_online_time += m.server_online_time / repetitions;
+                    mean_metrics[k].client_online_time += m.client_online_time / repetitions;
+                    mean_metrics[k].server_sent_bytes += m.server_sent_bytes / repetitions;
+                    mean_metrics[k].server_received_bytes += m.server_received_bytes / repetitions;
+                    mean_metrics[k].client_sent_bytes += m.client_sent_bytes / repetitions;
+                    mean_metrics[k].client_received_bytes += m.client_received_bytes / repetitions;
+                }
+
+                std::vector<long> expected = compute_intersection_non_private(client_sets, server_sets[0]);
+                std::cout << "Expected size: " << expected.size() << ", MPSI size: " << results[0].size();
+                std::cout << ", Sequential: " << sequential_time << " ms, Batched: " << batched_time << " ms" << std::endl;
+
+                sequential_times.push_back(static_cast<long>(sequential_time));
+                batched_times.push_back(static_cast<long>(batched_time));
+                sequential_bytes.push_back(sequential_session_bytes);
+                batched_bytes.push_back(batched_session_bytes);
+            }
+
+            batch_csv << t << "," 
+                    << batch_size << ","
+                    << sample_mean_computation(sequential_times) << ","
+                    << sample_mean_computation(batched_times) << ","
+                    << sample_mean_communication(sequential_bytes) << ","
+                    << sample_mean_communication(batched_bytes) << "\n";
+            for (long k = 0; k < batch_size; k++) {
+                const QueryMetrics& m = mean_metrics[k];
+                queries_csv << t << "," << batch_size << "," << k << ","
+                        << m.server_prep_time << ","
+                        << m.server_online_time << ","
+                        << m.client_online_time << ","
+                        << m.server_sent_bytes << ","
+                        << m.server_received_bytes << ","
+                        << m.client_sent_bytes << ","
+                        << m.client_received_bytes << "\n";
+            }
+        }
+    }
+}
+
+void benchmark_incremental(long repetitions, long number_of_parties, long set_size_clients, long set_size_server, 
+                           int false_positive_exponent, std::vector<long> delta_sizes) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream incremental_csv("../data/incremental.csv");
+    incremental_csv << "Parties,Server Set Size,Delta,Full Query,Incremental Query,Full Bytes,Incremental Bytes\n";
+
+    BloomFilterParams params(set_size_clients, false_positive_exponent); 
+    Keys keys;
+    key_gen(&keys, 1024, number_of_parties, number_of_parties); 
+
+    for (long delta : delta_sizes) {
+        std::cout << "\nBenchmarking incremental queries, " << delta << " of " << set_size_server << " server elements replaced" << std::endl;
+
+        std::vector<long> full_times, incremental_times;
+        std::vector<size_t> full_bytes, incremental_bytes;
+        for (int i = 0; i < repetitions; ++i) {
+            std::vector<std::vector<long>> client_sets;
+            std::vector<long> server_set;
+            generate_clients_and_server_sets(number_of_parties - 1, set_size_clients, set_size_server, 
+                domain_size, forced_intersection_size, client_sets, server_set);
+
+            // Warm the session with the previous server set
+            IncrementalSession session;
+            {
+                double client_prep_time = 0.0, client_online_time = 0.0, server_prep_time = 0.0, server_online_time = 0.0;
+                size_t server_sent_bytes = 0, server_received_bytes = 0, client_sent_bytes = 0, client_received_bytes = 0;
+                multiparty_psi_incremental(client_sets, server_set, params, keys, &session,
+                    &client_prep_time, &client_online_time, &server_prep_time, &server_online_time,
+                    &server_sent_bytes, &server_received_bytes, &client_sent_bytes, &client_received_bytes);
+            }
+
+            // Replace delta elements of the server set, half of them taken from the clients' intersection
+            std::vector<long> updated_set(server_set.begin() + delta, server_set.end());
+            std::vector<long> additions = sample_set(delta - delta / 2, domain_size);
+            for (long k = 0; k < delta / 2; k++) 
+                additions.push_back(client_sets[0][k % client_sets[0].size()]);
+            for (long x : additions) 
+                if (std::find(updated_set.begin(), updated_set.end(), x) == updated_set.end()) 
+                    updated_set.push_back(x);
+
+            for (bool incremental : {false, true}) {
+                double client_prep_time = 0.0;
+                double client_online_time = 0.0;
+                double server_prep_time = 0.0;
+                double server_online_time = 0.0;
+                size_t server_sent_bytes = 0;
+                size_t server_received_bytes = 0;
+                size_t client_sent_bytes = 0;
+                size_t client_received_bytes = 0;
+
+                std::vector<long> result;
+                if (incremental) 
+                    result = multiparty_psi_incremental(client_sets, updated_set, params, keys, &session,
+                        &client_prep_time, &client_online_time, &server_prep_time, &server_online_time,
+                        &server_sent_bytes, &server_received_bytes, &client_sent_bytes, &client_received_bytes);
+                else 
+                    result = multiparty_psi(client_sets, updated_set, params, keys,
+                        &client_prep_time, &client_online_time, &server_prep_time, &server_online_time,
+                        &server_sent_bytes, &server_received_bytes, &client_sent_bytes, &client_received_bytes);
+
+                std::vector<long> expected = compute_intersection_non_private(client_sets, updated_set);
+                double total_time = client_prep_time + client_online_time + server_prep_time + server_online_time;
+                std::cout << (incremental ? "Incremental: " : "Full:        ");
+                std::cout << "Expected size: " << expected.size() << ", MPSI size: " << result.size();
+                std::cout << ", Query time: " << total_time << " ms" << std::endl;
+
+                if (incremental) {
+                    incremental_times.push_back(static_cast<long>(total_time));
+                    incremental_bytes.push_back(server_sent_bytes + server_received_bytes);
+                } else {
+                    full_times.push_back(static_cast<long>(total_time));
+                    full_bytes.push_back(server_sent_bytes + server_received_bytes);
+                }
+            }
+        }
+
+        incremental_csv << number_of_parties << "," 
+                << set_size_server << ","
+                << delta << ","
+                << sample_mean_computation(full_times) << ","
+                << sample_mean_computation(incremental_times) << ","
+                << sample_mean_communication(full_bytes) << ","
+                << sample_mean_communication(incremental_bytes) << "\n";
+    }
+}
+
+void benchmark_erbf_updates(long repetitions, long number_of_parties, long set_size_clients, long set_size_server, 
+                            int false_positive_exponent, std::vector<double> change_fractions) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream update_csv("../data/erbf_updates.csv");
+    update_csv << "Parties,Client Set Size,Changed Elements,Flipped Bins,Rebuild Time,Update Time,Rebuild Bytes,Update Bytes,Requery Time\n";
+
+    BloomFilterParams params(set_size_clients, false_positive_exponent); 
+    Keys keys;
+    key_gen(&keys, 1024, number_of_parties, number_of_parties); 
+
+    for (double change_fraction : change_fractions) {
+        long changed = std::max(1L, static_cast<long>(change_fraction * set_size_clients));
+        std::cout << "\nBenchmarking ERBF updates, " << changed << " of " << set_size_clients << " client elements replaced" << std::endl;
+
+        std::vector<long> rebuild_times, update_times, requery_times;
+        std::vector<size_t> rebuild_bytes, update_bytes, flipped_bins;
+        for (int i = 0; i < repetitions; ++i) {
+            std::vector<std::vector<long>> client_sets;
+            std::vector<long> server_set;
+            generate_clients_and_server_sets(number_of_parties - 1, set_size_clients, set_size_server, 
+                domain_size, forced_intersection_size, client_sets, server_set);
+
+            CountingBloomFilter cbf(params);
+            for (long x : client_sets[0]) 
+                cbf.insert(x);
+
+            IncrementalSession session;
+            {
+                double client_prep_time = 0.0, client_online_time = 0.0, server_prep_time = 0.0, server_online_time = 0.0;
+                size_t server_sent_bytes = 0, server_received_bytes = 0, client_sent_bytes = 0, client_received_bytes = 0;
+                multiparty_psi_incremental(client_sets, server_set, params, keys, &session,
+                    &client_prep_time, &client_online_time, &server_prep_time, &server_online_time,
+                    &server_sent_bytes, &server_received_bytes, &client_sent_bytes, &client_received_bytes);
+            }
+
+            // Client 0 replaces some of its elements
+            std::vector<long> old_set = client_sets[0];
+            std::vector<long> replacements = sample_set(changed, domain_size);
+            for (long k = 0; k < changed; k++) 
+                client_sets[0][k] = replacements[k];
+
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<Ciphertext> rebuilt = compute_erbf(client_sets[0], params, keys);
+            auto stop = std::chrono::high_resolution_clock::now();
+            rebuild_times.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+            size_t rebuilt_size_bytes = 0;
+            for (const auto& ct : rebuilt) 
+                rebuilt_size_bytes += NumBytes(ct.c1) + NumBytes(ct.c2);
+            rebuild_bytes.push_back(rebuilt_size_bytes);
+
+            start = std::chrono::high_resolution_clock::now();
+            ErbfUpdate update = update_erbf(&cbf, old_set, client_sets[0], keys);
+            apply_erbf_update(&session, 0, update, params);
+            stop = std::chrono::high_resolution_clock::now();
+            update_times.push_back(std::chrono::duration_cast<std::chrono::milliseconds>(stop - start).count());
+            update_bytes.push_back(get_erbf_update_size(update));
+            flipped_bins.push_back(update.bins.size());
+
+            // Only server elements on flipped bins are evaluated again
+            double client_prep_time = 0.0;
+            double client_online_time = 0.0;
+            double server_prep_time = 0.0;
+            double server_online_time = 0.0;
+            size_t server_sent_bytes = 0;
+            size_t server_received_bytes = 0;
+            size_t client_sent_bytes = 0;
+            size_t client_received_bytes = 0;
+            std::vector<long> result = multiparty_psi_incremental(client_sets, server_set, params, keys, &session,
+                &client_prep_time, &client_online_time, &server_prep_time, &server_online_time,
+                &server_sent_bytes, &server_received_bytes, &client_sent_bytes, &client_received_bytes);
+            double requery_time = client_prep_time + client_online_time + server_prep_time + server_online_time;
+            requery_times.push_back(static_cast<long>(requery_time));
+
+            std::vector<long> expected = compute_intersection_non_private(client_sets, server_set);
+            std::cout << "Expected size: " << expected.size() << ", MPSI size: " << result.size();
+            std::cout << ", Flipped bins: " << update.bins.size() << " of " << params.bin_count << std::endl;
+        }
+
+        update_csv << number_of_parties << "," 
+                << set_size_clients << ","
+                << changed << ","
+                << sample_mean_communication(flipped_bins) << ","
+                << sample_mean_computation(rebuild_times) << ","
+                << sample_mean_computation(update_times) << ","
+                << sample_mean_communication(rebuild_bytes) << ","
+                << sample_mean_communication(update_bytes) << ","
+                << sample_mean_computation(requery_times) << "\n";
+    }
+}
+
+void benchmark_query_service(long number_of_parties, long set_size_clients, int false_positive_exponent, 
+                             long query_size, long query_count, double offered_rate, 
+                             std::vector<size_t> worker_counts, size_t queue_capacity) {
+    long long domain_size = (1LL << 32) - 1;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream service_csv("../data/query_service.csv");
+    service_csv << "Workers,Queue Capacity,Query Size,Offered Rate,Completed,Rejected,Throughput,P50,P90,P99,Max\n";
+    std::ofstream histogram_csv("../data/query_latency_histogram.csv");
+    histogram_csv << "Workers,Bucket Start,Count\n";
+
+    BloomFilterParams params(set_size_clients, false_positive_exponent); 
+    Keys keys;
+    key_gen(&keys, 1024, number_of_parties, number_of_parties); 
+
+    std::vector<std::vector<long>> client_sets;
+    std::vector<long> server_set;
+    generate_clients_and_server_sets(number_of_parties - 1, set_size_clients, query_size, 
+        domain_size, std::min(query_size, set_size_clients / 4), client_sets, server_set);
+    std::vector<std::vector<Ciphertext>> client_erbfs;
+    for (const auto& set : client_sets) 
+        client_erbfs.push_back(compute_erbf(set, params, keys));
+
+    for (size_t worker_count : worker_counts) {
+        std::cout << "\nBenchmarking query service with " << worker_count << " workers, " 
+                  << query_count << " queries of " << query_size << " elements" << std::endl;
+
+        ServiceConfig config;
+        config.worker_count = worker_count;
+        config.queue_capacity = queue_capacity;
+        QueryService service(client_erbfs, local_share_requests(keys, number_of_parties - 1), 
+                             params, keys.params, keys.key_shares[number_of_parties - 1], server_set, config);
+
+        // Open-loop arrivals at the offered rate, back to back if it is 0.
+        // Every other query is the same server set, the rest are fresh random sets.
+        std::vector<std::future<QueryResult>> results;
+        std::vector<bool> is_server_set;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (long k = 0; k < query_count; k++) {
+            if (offered_rate > 0) 
+                std::this_thread::sleep_until(start + std::chrono::duration<double>(k / offered_rate));
+            std::vector<long> query = k % 2 == 0 ? server_set : sample_set(query_size, domain_size);
+            std::future<QueryResult> result;
+            if (service.submit(query, &result)) {
+                results.push_back(std::move(result));
+                is_server_set.push_back(k % 2 == 0);
+            }
+        }
+
+        std::vector<long> expected = compute_intersection_non_private(client_sets, server_set);
+        size_t mpsi_size = 0;
+        for (size_t k = 0; k < results.size(); k++) {
+            QueryResult result = results[k].get();
+            if (is_server_set[k]) 
+                mpsi_size = result.intersection.size();
+        }
+        std::cout << "Expected size: " << expected.size() << ", MPSI size: " << mpsi_size << std::endl;
+
+        ServiceStats stats = service.stats();
+        std::cout << "Completed: " << stats.completed << ", Rejected: " << stats.rejected;
+        std::cout << ", Throughput: " << stats.throughput << " queries/s";
+        std::cout << ", p50: " << stats.latencies.percentile(50) << " ms, p99: " << stats.latencies.percentile(99) << " ms" << std::endl;
+
+        service_csv << worker_count << ","
+                << queue_capacity << ","
+                << query_size << ","
+                << offered_rate << ","
+                << stats.completed << ","
+                << stats.rejected << ","
+                << stats.throughput << ","
+                << stats.latencies.percentile(50) << ","
+                << stats.latencies.percentile(90) << ","
+                << stats.latencies.percentile(99) << ","
+                << stats.latencies.percentile(100) << "\n";
+        for (size_t b = 0; b < stats.latencies.counts.size(); b++) 
+            if (stats.latencies.counts[b] > 0) 
+                histogram_csv << worker_count << "," << b * stats.latencies.bucket_ms << "," << stats.latencies.counts[b] << "\n";
+    }
+}
+
+void benchmark_sharded(long repetitions, long number_of_parties, long set_size_clients, std::vector<long> set_sizes_server, 
+                       int false_positive_exponent, std::vector<size_t> worker_counts) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream sharded_csv("../data/sharded.csv");
+    sharded_csv << "Parties,Server Set Size,Workers,Single Process Online,Sharded Online,Max Worker Time,Coordinator Sent,Coordinator Received\n";
+
+    BloomFilterParams params(set_size_clients, false_positive_exponent); 
+    Keys keys;
+    key_gen(&keys, 1024, number_of_parties, number_of_parties); 
+
+    for (long set_size_server : set_sizes_server) {
+        for (size_t worker_count : worker_counts) {
+            std::cout << "\nBenchmarking " << set_size_server << " server elements over " << worker_count << " worker processes" << std::endl;
+
+            std::vector<long> single_times, sharded_times, max_worker_times;
+            std::vector<size_t> sent_bytes, received_bytes;
+            for (int i = 0; i < repetitions; ++i) {
+                std::vector<std::vector<long>> client_sets;
+                std::vector<long> server_set;
+                generate_clients_and_server_sets(number_of_parties - 1, set_size_clients, set_size_server, 
+                    domain_size, forced_intersection_size, client_sets, server_set);
+
+                double client_prep_time = 0.0;
+                double client_online_time = 0.0;
+                double server_prep_time = 0.0;
+                double server_online_time = 0.0;
+                size_t server_sent_bytes = 0;
+                size_t server_received_bytes = 0;
+                size_t client_sent_bytes = 0;
+                size_t client_received_bytes = 0;
+                multiparty_psi(client_sets, server_set, params, keys,
+                    &client_prep_time, &client_online_time, &server_prep_time, &server_online_time,
+                    &server_sent_bytes, &server_received_bytes, &client_sent_bytes, &client_received_bytes);
+                // Single process, the same work the sharded online time covers: aggregation, decryption and the
+                // server's own decryption shares, which multiparty_psi counts in client_online_time over n - 1 clients
+                double share_time_per_party = client_online_time * (number_of_parties - 1) / number_of_parties;
+                single_times.push_back(static_cast<long>(server_online_time + share_time_per_party));
+
+                ShardingConfig config;
+                config.local_workers = worker_count;
+                double sharded_online_time = 0.0;
+                size_t coordinator_sent_bytes = 0;
+                size_t coordinator_received_bytes = 0;
+                std::vector<double> worker_times;
+                std::vector<long> result = multiparty_psi_sharded(client_sets, server_set, params, keys, config,
+                    &client_prep_time, &client_online_time, &server_prep_time, &sharded_online_time,
+                    &coordinator_sent_bytes, &coordinator_received_bytes, &worker_times);
+
+                std::vector<long> expected = compute_intersection_non_private(client_sets, server_set);
+                std::cout << "Expected size: " << expected.size() << ", MPSI size: " << result.size();
+                std::cout << ", Sharded online: " << sharded_online_time << " ms" << std::endl;
+
+                sharded_times.push_back(static_cast<long>(sharded_online_time));
+                max_worker_times.push_back(static_cast<long>(*std::max_element(worker_times.begin(), worker_times.end())));
+                sent_bytes.push_back(coordinator_sent_bytes);
+                received_bytes.push_back(coordinator_received_bytes);
+            }
+
+            sharded_csv << number_of_parties << "," 
+                    << set_size_server << ","
+                    << worker_count << ","
+                    << sample_mean_computation(single_times) << ","
+                    << sample_mean_computation(sharded_times) << ","
+                    << sample_mean_computation(max_worker_times) << ","
+                    << sample_mean_communication(sent_bytes) << ","
+                    << sample_mean_communication(received_bytes) << "\n";
+        }
+    }
 }
\ No newline at end of file
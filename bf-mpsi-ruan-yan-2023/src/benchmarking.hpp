@@ -2,6 +2,8 @@
 #define BENCHMARKING_HPP
 
 #include <vector>
+#include <string>
+#include "mpsi_protocol.hpp"
 
 void benchmark(
     long repetitions, 
@@ -11,4 +13,90 @@ void benchmark(
     int false_positive_exponent
 );
 
+void benchmark_concurrent(
+    long repetitions, 
+    std::vector<long> parties_list, 
+    long set_size_clients, 
+    long set_size_server,
+    int false_positive_exponent,
+    const SimulationConfig& config
+);
+
+void benchmark_stragglers(
+    long repetitions, 
+    std::vector<long> parties_list, 
+    long set_size_clients, 
+    long set_size_server,
+    int false_positive_exponent,
+    double threshold_fraction,
+    long slow_parties,
+    double slow_party_delay_ms
+);
+
+void benchmark_erbf_cache(
+    long repetitions, 
+    std::vector<long> parties_list, 
+    long set_size_clients, 
+    long set_size_server,
+    int false_positive_exponent,
+    const std::string& cache_directory
+);
+
+void benchmark_blinding_store(
+    long repetitions, 
+    long number_of_parties, 
+    long set_size_clients, 
+    std::vector<long> set_sizes_server,
+    int false_positive_exponent,
+    const std::string& store_directory,
+    size_t worker_count
+);
+
+void benchmark_batch(
+    long repetitions, 
+    std::vector<long> parties_list, 
+    long set_size_clients, 
+    long set_size_server,
+    int false_positive_exponent,
+    std::vector<long> batch_sizes
+);
+
+void benchmark_incremental(
+    long repetitions, 
+    long number_of_parties, 
+    long set_size_clients, 
+    long set_size_server,
+    int false_positive_exponent,
+    std::vector<long> delta_sizes
+);
+
+void benchmark_erbf_updates(
+    long repetitions, 
+    long number_of_parties, 
+    long set_size_clients, 
+    long set_size_server,
+    int false_positive_exponent,
+    std::vector<double> change_fractions
+);
+
+void benchmark_query_service(
+    long number_of_parties, 
+    long set_size_clients, 
+    int false_positive_exponent,
+    long query_size,
+    long query_count,
+    double offered_rate,
+    std::vector<size_t> worker_counts,
+    size_t queue_capacity
+);
+
+void benchmark_sharded(
+    long repetitions, 
+    long number_of_parties, 
+    long set_size_clients, 
+    std::vector<long> set_sizes_server,
+    int false_positive_exponent,
+    std::vector<size_t> worker_counts
+);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "blinding_store.hpp"
+#include "erbf_cache.hpp"
+#include <unordered_map>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+
+BlindingStore::BlindingStore(const std::string& directory, size_t worker_count) : directory(directory) {
+    std::filesystem::create_directories(directory);
+    for (size_t i = 0; i < std::max<size_t>(worker_count, 1); i++) 
+        workers.emplace_back(&BlindingStore::worker_loop, this);
+}
+
+BlindingStore::~BlindingStore() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_available.notify_all();
+    for (auto& worker : workers) 
+        worker.join();
+}
+
+std::string BlindingStore::path(uint64_t set_digest, uint64_t key_digest) const {
+    std::ostringstream name;
+    name << directory << "/server_" << std::hex << set_digest << "_" << key_digest << ".blinding";
+    return name.str();
+}
+
+void BlindingStore::prepare(const std::vector<long>& set, const PublicParameters& params) {
+    uint64_t set_digest = digest_set(set);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.count(set_digest)) 
+            return;
+        pending.insert(set_digest);
+        jobs.push_back({set, set_digest, digest_keys(params), params});
+    }
+    job_available.notify_one();
+}
+
+void BlindingStore::wait_idle() {
+    std::unique_lock<std::mutex> lock(mutex);
+    job_done.wait(lock, [&] { return pending.empty(); });
+}
+
+void BlindingStore::worker_loop() {
+    seed_thread_rng();
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            job_available.wait(lock, [&] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) 
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        blind_and_store(job);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.erase(job.set_digest);
+        }
+        job_done.notify_all();
+    }
+}
+
+std::shared_ptr<const std::pair<FixedBaseTable, FixedBaseTable>> BlindingStore::tables_for(const Job& job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tables && tables_key_digest == job.key_digest) 
+            return tables;
+    }
+    long exponent_bits = NumBits((job.params.p - 1) / 2);
+    auto built = std::make_shared<const std::pair<FixedBaseTable, FixedBaseTable>>(
+        FixedBaseTable(job.params.g, job.params.p, exponent_bits), 
+        FixedBaseTable(job.params.pk, job.params.p, exponent_bits));
+    std::lock_guard<std::mutex> lock(mutex);
+    tables = built;
+    tables_key_digest = job.key_digest;
+    return built;
+}
+
+// Same blinding as set_blinding, with the encryptions done through fixed-base tables
+void BlindingStore::blind_and_store(const Job& job) {
+    auto job_tables = tables_for(job);
+    const ZZ& p = job.params.p;
+
+    BlindingFileHeader header = {};
+    std::memcpy(header.magic, "BLND", 4);
+    header.version = 2;
+    header.key_digest = job.key_digest;
+    header.set_digest = job.set_digest;
+    header.count = job.set.size();
+    header.element_bytes = NumBytes(p);
+
+    std::string final_path = path(job.set_digest, job.key_digest);
+    std::string tmp_path = final_path + ".tmp";
+
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::vector<unsigned char> record(sizeof(int64_t) + 3 * header.element_bytes);
+    for (long x : job.set) {
+        ZZ r = RandomBnd(p - 1) + 1;
+        ZZ blinded = MulMod(to_ZZ(x + 1), r, p); // avoid encrypting 0
+        Ciphertext w = encrypt(blinded, job_tables->first, job_tables->second);
+
+        int64_t element = x;
+        std::memcpy(record.data(), &element, sizeof(element));
+        unsigned char* values = record.data() + sizeof(int64_t);
+        BytesFromZZ(values, r, header.element_bytes);
+        BytesFromZZ(values + header.element_bytes, w.c1, header.element_bytes);
+        BytesFromZZ(values + 2 * header.element_bytes, w.c2, header.element_bytes);
+        out.write(reinterpret_cast<const char*>(record.data()), record.size());
+    }
+    out.close();
+    // A failed write leaves no file, take() then falls back to blinding online
+    if (!out || std::rename(tmp_path.c_str(), final_path.c_str()) != 0) 
+        std::remove(tmp_path.c_str());
+}
+
+bool BlindingStore::take(const std::vector<long>& set, const PublicParameters& params, 
+                         std::vector<ZZ>& r_js, std::vector<Ciphertext>& w_js) {
+    uint64_t set_digest = digest_set(set);
+    uint64_t key_digest = digest_keys(params);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        job_done.wait(lock, [&] { return !pending.count(set_digest); });
+    }
+
+    std::ifstream in(path(set_digest, key_digest), std::ios::binary);
+    if (!in) 
+        return false;
+    BlindingFileHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || std::memcmp(header.magic, "BLND", 4) != 0 || header.version != 2 || 
+        header.key_digest != key_digest || header.element_bytes != static_cast<uint64_t>(NumBytes(params.p)) || header.set_digest != set_digest || header.count != set.size()) 
+        return false;
+
+    // Records are in the order the set was prepared in, the query may list it differently
+    std::unordered_map<long, size_t> position;
+    for (size_t j = 0; j < set.size(); j++) 
+        position[set[j]] = j;
+
+    std::vector<ZZ> loaded_r_js(set.size());
+    std::vector<Ciphertext> loaded_w_js(set.size());
+    std::vector<unsigned char> record(sizeof(int64_t) + 3 * header.element_bytes);
+    for (uint64_t k = 0; k < header.count; k++) {
+        in.read(reinterpret_cast<char*>(record.data()), record.size());
+        if (!in) 
+            return false;
+        int64_t element;
+        std::memcpy(&element, record.data(), sizeof(element));
+        auto it = position.find(element);
+        if (it == position.end()) 
+            return false;
+        const unsigned char* values = record.data() + sizeof(int64_t);
+        loaded_r_js[it->second] = ZZFromBytes(values, header.element_bytes);
+        loaded_w_js[it->second] = {ZZFromBytes(values + header.element_bytes, header.element_bytes), 
+                            ZZFromBytes(values + 2 * header.element_bytes, header.element_bytes)};
+    }
+
+    r_js = std::move(loaded_r_js);
+    w_js = std::move(loaded_w_js);
+
+    // Every blinding is used for exactly one query
+    std::filesystem::remove(path(set_digest, key_digest));
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef BLINDING_STORE_HPP
+#define BLINDING_STORE_HPP
+
+#include <vector>
+#include <string>
+#include <set>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <NTL/ZZ.h>
+#include "el_gamal.hpp"
+
+// On-disk layout: the header, followed by count (x, r, c1, c2) records where x
+// is a little-endian int64 and every other value takes exactly element_bytes bytes
+struct BlindingFileHeader {
+    char magic[4]; // "BLND"
+    uint32_t version;
+    uint64_t key_digest; // digest_keys of the keys the set was blinded under
+    uint64_t set_digest;
+    uint64_t count;
+    uint64_t element_bytes;
+};
+
+// Server-side preparation service: blinds announced server sets on background
+// threads and persists r_js / w_js, so queries only have to load them.
+struct BlindingStore {
+    std::string directory;
+
+    BlindingStore(const std::string& directory, size_t worker_count);
+    ~BlindingStore();
+    BlindingStore(const BlindingStore&) = delete;
+    BlindingStore& operator=(const BlindingStore&) = delete;
+
+    // Queues an upcoming server set for blinding
+    void prepare(const std::vector<long>& set, const PublicParameters& params);
+    // Waits for the set if it is still being prepared; false if it was never prepared under these keys
+    bool take(const std::vector<long>& set, const PublicParameters& params, 
+              std::vector<ZZ>& r_js, std::vector<Ciphertext>& w_js);
+    void wait_idle();
+
+    std::string path(uint64_t set_digest, uint64_t key_digest) const;
+
+private:
+    struct Job {
+        std::vector<long> set;
+        uint64_t set_digest;
+        uint64_t key_digest;
+        PublicParameters params;
+    };
+
+    void worker_loop();
+    void blind_and_store(const Job& job);
+    std::shared_ptr<const std::pair<FixedBaseTable, FixedBaseTable>> tables_for(const Job& job);
+
+    std::mutex mutex;
+    std::condition_variable job_available;
+    std::condition_variable job_done;
+    std::deque<Job> jobs;
+    std::set<uint64_t> pending; // digests queued or in progress
+    bool stopping = false;
+    std::vector<std::thread> workers;
+
+    // Fixed-base tables for g and pk, shared by the workers while the keys stay the same
+    std::shared_ptr<const std::pair<FixedBaseTable, FixedBaseTable>> tables;
+    uint64_t tables_key_digest = 0;
+};
+
+#endif
\ No newline at end of file
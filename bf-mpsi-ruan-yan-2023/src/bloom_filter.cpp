@@ -54,4 +54,32 @@ bool BloomFilter::contains(const size_t& element) const {
         }
     }
     return true;
+}
+
+CountingBloomFilter::CountingBloomFilter(const BloomFilterParams& params) {
+    this->seeds = params.seeds;
+    this->counters.resize(params.bin_count, 0);
+}
+
+std::vector<size_t> CountingBloomFilter::bins_of(size_t element) const {
+    size_t bin_count = counters.size();
+    std::vector<size_t> bins;
+    bins.reserve(seeds.size());
+    for (uint64_t seed : seeds) {
+        bins.push_back(hash_element(element, seed) % bin_count);
+    }
+    return bins;
+}
+
+void CountingBloomFilter::insert(size_t element) {
+    for (size_t bin : bins_of(element)) {
+        counters[bin]++;
+    }
+}
+
+void CountingBloomFilter::remove(size_t element) {
+    for (size_t bin : bins_of(element)) {
+        if (counters[bin] > 0) 
+            counters[bin]--;
+    }
 }
\ No newline at end of file
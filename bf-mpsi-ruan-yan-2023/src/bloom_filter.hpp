@@ -31,4 +31,18 @@ struct BloomFilter {
     size_t get_set_bits_count() const;
 };
 
+// Bloom filter with a counter per bin, so elements can be removed again
+struct CountingBloomFilter {
+    std::vector<uint32_t> counters; // m bins
+    std::vector<uint64_t> seeds; // k hash functions
+
+    explicit CountingBloomFilter(const BloomFilterParams& params);
+
+    void insert(size_t element);
+    void remove(size_t element);
+    std::vector<size_t> bins_of(size_t element) const;
+
+    bool contains_bit(size_t index) const { return counters[index] > 0; }
+};
+
 #endif
\ No newline at end of file
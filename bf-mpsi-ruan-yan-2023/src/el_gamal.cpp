@@ -1,4 +1,6 @@
 #include "el_gamal.hpp"
+#include <random>
+#include <cstring>
 
 void key_gen(Keys* keys, long key_length, long t, long n) {
     ZZ q;
@@ -21,6 +23,7 @@ void key_gen(Keys* keys, long key_length, long t, long n) {
     for(int i = 1; i < t; i++) 
         poly[i] = RandomBnd(keys->params.p - 1);
 
+    keys->threshold = t;
     keys->key_shares.clear();
     for(int i = 1; i <= n; i++) {
         ZZ val = to_ZZ(0); // f(i)
@@ -42,10 +45,18 @@ Ciphertext encrypt(const ZZ& message, const PublicParameters& params) {
 }
 
 ZZ compute_delta(int i, int t, const ZZ& q) {
+    std::vector<int> parties;
+    for (int j = 1; j <= t; j++) 
+        parties.push_back(j);
+    return compute_delta(i, parties, q);
+}
+
+// Lagrange coefficient at 0 of party i for an arbitrary subset of (1-indexed) parties
+ZZ compute_delta(int i, const std::vector<int>& parties, const ZZ& q) {
     ZZ num = to_ZZ(1);
     ZZ den = to_ZZ(1);
 
-    for (int j = 1; j <= t; j++) {
+    for (int j : parties) {
         if (i == j) continue;
         num = MulMod(num, to_ZZ(j), q);
 
@@ -63,4 +74,65 @@ ZZ compute_share(const ZZ& c1, const ZZ& sk_i, const ZZ& delta_i, const ZZ& p) {
     ZZ q = (p - 1) / 2;
     ZZ exponent = MulMod(delta_i, sk_i, q);
     return PowerMod(c1, exponent, p);
+}
+
+// sh_{j,i} = c_{j,1} ^ {sk_i} mod p, the Lagrange coefficient is applied by the combiner
+ZZ compute_raw_share(const ZZ& c1, const ZZ& sk_i, const ZZ& p) {
+    return PowerMod(c1, sk_i, p);
+}
+
+FixedBaseTable::FixedBaseTable(const ZZ& base, const ZZ& p, long exponent_bits, long window) {
+    this->p = p;
+    this->window = window;
+    long windows = (exponent_bits + window - 1) / window;
+    long digits = 1L << window;
+
+    powers.resize(windows);
+    ZZ window_base = base; // base^(2^(window * i))
+    for (long i = 0; i < windows; i++) {
+        powers[i].resize(digits);
+        powers[i][0] = to_ZZ(1);
+        for (long d = 1; d < digits; d++) 
+            powers[i][d] = MulMod(powers[i][d - 1], window_base, p);
+        window_base = MulMod(powers[i][digits - 1], window_base, p);
+    }
+}
+
+ZZ FixedBaseTable::power(const ZZ& exponent) const {
+    ZZ result = to_ZZ(1);
+    for (size_t i = 0; i < powers.size(); i++) {
+        long digit = 0;
+        for (long b = 0; b < window; b++) 
+            digit |= bit(exponent, window * i + b) << b;
+        if (digit != 0) 
+            result = MulMod(result, powers[i][digit], p);
+    }
+    return result;
+}
+
+Ciphertext encrypt(const ZZ& message, const FixedBaseTable& g_table, const FixedBaseTable& pk_table) {
+    ZZ q = (g_table.p - 1) / 2;
+    ZZ r = RandomBnd(q - 1) + 1;
+    Ciphertext ct;
+    ct.c1 = g_table.power(r);
+    ct.c2 = MulMod(message, pk_table.power(r), pk_table.p);
+    return ct;
+}
+
+// (c1 * g^s, c2 * pk^s) encrypts the same message under fresh randomness
+Ciphertext rerandomize(const Ciphertext& ct, const FixedBaseTable& g_table, const FixedBaseTable& pk_table) {
+    ZZ q = (g_table.p - 1) / 2;
+    ZZ s = RandomBnd(q - 1) + 1;
+    return {MulMod(ct.c1, g_table.power(s), g_table.p), 
+            MulMod(ct.c2, pk_table.power(s), pk_table.p)};
+}
+
+void seed_thread_rng() {
+    std::random_device random_device;
+    unsigned char seed[32];
+    for (size_t b = 0; b < sizeof(seed); b += sizeof(unsigned int)) {
+        unsigned int word = random_device();
+        std::memcpy(seed + b, &word, sizeof(word));
+    }
+    SetSeed(seed, sizeof(seed));
 }
\ No newline at end of file
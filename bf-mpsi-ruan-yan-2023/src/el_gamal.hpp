@@ -15,6 +15,7 @@ struct PublicParameters {
 struct Keys {
     PublicParameters params;
     std::vector<ZZ> key_shares; 
+    long threshold = 0; // t of the n key shares are needed to decrypt
 };
 
 struct Ciphertext {
@@ -22,9 +23,26 @@ struct Ciphertext {
     ZZ c2; 
 };
 
+// Fixed-base exponentiation: powers[i][d] = base^(d * 2^(window * i)) mod p,
+// so an exponentiation costs one multiplication per window and no squarings
+struct FixedBaseTable {
+    ZZ p;
+    long window;
+    std::vector<std::vector<ZZ>> powers;
+
+    FixedBaseTable(const ZZ& base, const ZZ& p, long exponent_bits, long window = 6);
+    ZZ power(const ZZ& exponent) const;
+};
+
 void key_gen(Keys* keys, long key_length, long t, long n);
 Ciphertext encrypt(const ZZ& message, const PublicParameters& params);
+Ciphertext encrypt(const ZZ& message, const FixedBaseTable& g_table, const FixedBaseTable& pk_table);
 ZZ compute_delta(int i, int t, const ZZ& p);
 ZZ compute_share(const ZZ& c1, const ZZ& sk_i, const ZZ& delta_i, const ZZ& p);
+ZZ compute_delta(int i, const std::vector<int>& parties, const ZZ& q);
+ZZ compute_raw_share(const ZZ& c1, const ZZ& sk_i, const ZZ& p);
+Ciphertext rerandomize(const Ciphertext& ct, const FixedBaseTable& g_table, const FixedBaseTable& pk_table);
+// NTL keeps one random stream per thread, this seeds the caller's with 32 bytes of system entropy
+void seed_thread_rng();
 
 #endif
\ No newline at end of file
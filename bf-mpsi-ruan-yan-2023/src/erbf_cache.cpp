@@ -0,0 +1,174 @@
+#include "erbf_cache.hpp"
+#include "mpsi_protocol.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+// Order-independent digest of a set
+uint64_t digest_set(const std::vector<long>& set) {
+    std::vector<long> sorted = set;
+    std::sort(sorted.begin(), sorted.end());
+    return XXH3_64bits(sorted.data(), sorted.size() * sizeof(long));
+}
+
+uint64_t digest_params(const BloomFilterParams& bf_params) {
+    uint64_t bin_count = bf_params.bin_count;
+    return XXH3_64bits_withSeed(bf_params.seeds.data(), bf_params.seeds.size() * sizeof(uint64_t), bin_count);
+}
+
+uint64_t digest_keys(const PublicParameters& params) {
+    long element_bytes = NumBytes(params.p);
+    std::vector<unsigned char> bytes(3 * element_bytes);
+    BytesFromZZ(bytes.data(), params.p, element_bytes);
+    BytesFromZZ(bytes.data() + element_bytes, params.g, element_bytes);
+    BytesFromZZ(bytes.data() + 2 * element_bytes, params.pk, element_bytes);
+    return XXH3_64bits(bytes.data(), bytes.size());
+}
+
+MappedErbf::MappedErbf(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) 
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ErbfFileHeader)) {
+        void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED) {
+            data = static_cast<const unsigned char*>(mapping);
+            size = st.st_size;
+        }
+    }
+    close(fd);
+
+    if (valid()) {
+        const ErbfFileHeader& h = header();
+        bool complete = std::memcmp(h.magic, "ERBF", 4) == 0 && h.version == 2 && 
+                        size == sizeof(ErbfFileHeader) + h.bin_count * 2 * h.element_bytes;
+        if (!complete) {
+            munmap(const_cast<unsigned char*>(data), size);
+            data = nullptr;
+            size = 0;
+        }
+    }
+}
+
+MappedErbf::~MappedErbf() {
+    if (valid()) 
+        munmap(const_cast<unsigned char*>(data), size);
+}
+
+Ciphertext MappedErbf::get(size_t bin) const {
+    size_t element_bytes = header().element_bytes;
+    const unsigned char* record = data + sizeof(ErbfFileHeader) + bin * 2 * element_bytes;
+    return {ZZFromBytes(record, element_bytes), ZZFromBytes(record + element_bytes, element_bytes)};
+}
+
+bool write_erbf_file(const std::string& path, const ErbfCacheKey& key, 
+                     const std::vector<Ciphertext>& erbf, const Keys& keys) {
+    ErbfFileHeader header = {};
+    std::memcpy(header.magic, "ERBF", 4);
+    header.version = 2;
+    header.key_digest = key.key_digest;
+    header.set_digest = key.set_digest;
+    header.params_digest = key.params_digest;
+    header.bin_count = erbf.size();
+    header.element_bytes = NumBytes(keys.params.p);
+
+    // Written to a temporary file first, so readers never map a partial ERBF
+    std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::vector<unsigned char> record(2 * header.element_bytes);
+    for (const auto& ct : erbf) {
+        BytesFromZZ(record.data(), ct.c1, header.element_bytes);
+        BytesFromZZ(record.data() + header.element_bytes, ct.c2, header.element_bytes);
+        out.write(reinterpret_cast<const char*>(record.data()), record.size());
+    }
+    out.close();
+    if (!out || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+ErbfCache::ErbfCache(const std::string& directory) : directory(directory) {
+    std::filesystem::create_directories(directory);
+}
+
+std::string ErbfCache::path(const ErbfCacheKey& key) const {
+    std::ostringstream name;
+    name << directory << "/client_" << key.client_id << std::hex 
+         << "_" << key.set_digest << "_" << key.params_digest << "_" << key.key_digest << ".erbf";
+    return name.str();
+}
+
+bool ErbfCache::load(const ErbfCacheKey& key, std::vector<Ciphertext>& erbf) const {
+    MappedErbf mapped(path(key));
+    if (!mapped.valid()) 
+        return false;
+    const ErbfFileHeader& h = mapped.header();
+    if (h.key_digest != key.key_digest || h.set_digest != key.set_digest || h.params_digest != key.params_digest) 
+        return false;
+
+    erbf.clear();
+    erbf.reserve(mapped.bin_count());
+    for (size_t l = 0; l < mapped.bin_count(); l++) 
+        erbf.push_back(mapped.get(l));
+    return true;
+}
+
+bool ErbfCache::store(const ErbfCacheKey& key, const std::vector<Ciphertext>& erbf, const Keys& keys) const {
+    return write_erbf_file(path(key), key, erbf, keys);
+}
+
+std::vector<Ciphertext> ErbfCache::get_or_compute(long client_id, 
+                                                 const std::vector<long>& set, 
+                                                 const BloomFilterParams& bf_params, 
+                                                 const Keys& keys) {
+    ErbfCacheKey key = {client_id, digest_set(set), digest_params(bf_params), digest_keys(keys.params)};
+    std::vector<Ciphertext> erbf;
+    if (!load(key, erbf)) {
+        misses++;
+        erbf = compute_erbf(set, bf_params, keys);
+        store(key, erbf, keys); // a failed write only costs the next query a rebuild
+        return erbf;
+    }
+    hits++;
+
+    if (rerandomize) {
+        if (!g_table || tables_key_digest != key.key_digest) {
+            long exponent_bits = NumBits((keys.params.p - 1) / 2);
+            g_table = std::make_unique<FixedBaseTable>(keys.params.g, keys.params.p, exponent_bits);
+            pk_table = std::make_unique<FixedBaseTable>(keys.params.pk, keys.params.p, exponent_bits);
+            tables_key_digest = key.key_digest;
+        }
+        // Fresh ElGamal randomness alone would keep the random plaintexts of the unset bins,
+        // and the server would decrypt the same products for non-members in every session.
+        // Unset bins are multiplied by Enc(u) for a fresh random u instead, which refreshes both.
+        BloomFilter bf(bf_params);
+        for (size_t x : set) 
+            bf.insert(x);
+        const ZZ& p = keys.params.p;
+        for (size_t l = 0; l < erbf.size(); l++) {
+            if (bf.contains_bit(l)) {
+                erbf[l] = ::rerandomize(erbf[l], *g_table, *pk_table);
+            } else {
+                Ciphertext mask = encrypt(RandomBnd(p - 2) + 2, *g_table, *pk_table);
+                erbf[l].c1 = MulMod(erbf[l].c1, mask.c1, p);
+                erbf[l].c2 = MulMod(erbf[l].c2, mask.c2, p);
+            }
+        }
+    }
+    return erbf;
+}
\ No newline at end of file
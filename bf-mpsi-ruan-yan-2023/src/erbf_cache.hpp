@@ -0,0 +1,80 @@
+#ifndef ERBF_CACHE_HPP
+#define ERBF_CACHE_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <NTL/ZZ.h>
+#include "el_gamal.hpp"
+#include "bloom_filter.hpp"
+
+uint64_t digest_set(const std::vector<long>& set);
+uint64_t digest_params(const BloomFilterParams& bf_params);
+uint64_t digest_keys(const PublicParameters& params); // (p, g, pk), changes with every key_gen
+
+struct ErbfCacheKey {
+    long client_id;
+    uint64_t set_digest;
+    uint64_t params_digest;
+    uint64_t key_digest;
+};
+
+// On-disk layout: the header, followed by bin_count (c1, c2) pairs where every
+// value is stored little-endian in exactly element_bytes bytes
+struct ErbfFileHeader {
+    char magic[4]; // "ERBF"
+    uint32_t version;
+    uint64_t key_digest;
+    uint64_t set_digest;
+    uint64_t params_digest;
+    uint64_t bin_count;
+    uint64_t element_bytes;
+};
+
+// Read-only memory mapping of a cached ERBF
+struct MappedErbf {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+    explicit MappedErbf(const std::string& path);
+    ~MappedErbf();
+    MappedErbf(const MappedErbf&) = delete;
+    MappedErbf& operator=(const MappedErbf&) = delete;
+
+    bool valid() const { return data != nullptr; }
+    const ErbfFileHeader& header() const { return *reinterpret_cast<const ErbfFileHeader*>(data); }
+    size_t bin_count() const { return header().bin_count; }
+    Ciphertext get(size_t bin) const;
+};
+
+// Returns false if the file could not be written completely
+bool write_erbf_file(const std::string& path, const ErbfCacheKey& key, 
+                     const std::vector<Ciphertext>& erbf, const Keys& keys);
+
+struct ErbfCache {
+    std::string directory;
+    bool rerandomize = false; // re-randomize hits, randomness and unset-bin plaintexts, so ERBFs are unlinkable across sessions
+    size_t hits = 0;
+    size_t misses = 0;
+
+    explicit ErbfCache(const std::string& directory);
+
+    std::string path(const ErbfCacheKey& key) const;
+    bool load(const ErbfCacheKey& key, std::vector<Ciphertext>& erbf) const;
+    bool store(const ErbfCacheKey& key, const std::vector<Ciphertext>& erbf, const Keys& keys) const;
+
+    // Returns the client's ERBF from the cache, building and storing it on a miss
+    std::vector<Ciphertext> get_or_compute(long client_id, 
+                                           const std::vector<long>& set, 
+                                           const BloomFilterParams& bf_params, 
+                                           const Keys& keys);
+
+private:
+    // Fixed-base tables for re-randomization, built for the keys with digest tables_key_digest
+    std::unique_ptr<FixedBaseTable> g_table;
+    std::unique_ptr<FixedBaseTable> pk_table;
+    uint64_t tables_key_digest = 0;
+};
+
+#endif
\ No newline at end of file
@@ -5,13 +5,41 @@
 #include <string>
 #include <algorithm>
 #include <random>
+#include <thread>
 #include "mpsi_protocol.hpp"
 #include "benchmarking.hpp"
 #include "experiments.hpp"
+#include "sharding.hpp"
+#include "query_service.hpp"
 
-int main() {
+int main(int argc, char** argv) {
     srand(time(NULL));
 
+    // Load test of the resident query service alone (10 parties, 256-element client sets, 1000 queries
+    // of 16 elements), then exit: ./ruan_mpsi_shamir --bench-service [workers] [queue capacity] [queries per second]
+    if (argc > 1 && std::string(argv[1]) == "--bench-service") {
+        size_t workers = argc > 2 ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+        size_t queue_capacity = argc > 3 ? std::stoul(argv[3]) : 64;
+        double offered_rate = argc > 4 ? std::stod(argv[4]) : 0.0;
+        benchmark_query_service(10, 256, -7, 16, 1000, offered_rate, {workers}, queue_capacity);
+        return 0;
+    }
+
+    // Resident query server: ./ruan_mpsi_shamir --serve <client sets file> <server set file> [workers] [queue capacity]
+    // One client set per line, queries are read from stdin one per line until EOF, results go to stdout
+    if (argc > 3 && std::string(argv[1]) == "--serve") {
+        ServiceConfig config;
+        config.worker_count = argc > 4 ? std::stoul(argv[4]) : std::thread::hardware_concurrency();
+        config.queue_capacity = argc > 5 ? std::stoul(argv[5]) : 64;
+        return run_query_service(argv[2], argv[3], -7, config);
+    }
+
+    // Aggregation worker for the sharded mode on other nodes: ./ruan_mpsi_shamir --worker <port> [bind address]
+    // Listens on the loopback interface unless an address is given
+    if (argc > 2 && std::string(argv[1]) == "--worker") 
+        return run_aggregation_worker(argc > 3 ? argv[3] : "127.0.0.1", 
+                                      static_cast<uint16_t>(std::stoul(argv[2])));
+
     run_experiment({ {1, 2, 3}, {1, 3, 4} }, // Clients
         {1, 3, 5} // Server
     );
@@ -33,5 +61,26 @@ int main() {
     );
 
     benchmark(10, {2, 3, 5, 10, 20, 30, 40, 50, 100}, 256, 1024, -7);
+
+    SimulationConfig concurrent_config;
+    concurrent_config.pin_cores = true;
+    benchmark_concurrent(10, {2, 3, 5, 10, 20, 30, 40, 50, 100}, 256, 1024, -7, concurrent_config);
+
+    // 2/3 threshold, 2 slow clients answering 500 ms late
+    benchmark_stragglers(100, {10, 20, 50, 100}, 256, 1024, -7, 2.0 / 3.0, 2, 500.0);
+
+    benchmark_erbf_cache(10, {2, 3, 5, 10, 20, 50}, 256, 1024, -7, "../data/erbf_cache");
+
+    benchmark_blinding_store(10, 10, 256, {256, 512, 1024, 2048}, -7, "../data/blinding_store", std::thread::hardware_concurrency());
+
+    benchmark_batch(10, {3, 10, 50}, 256, 1024, -7, {1, 5, 10, 20});
+
+    benchmark_incremental(10, 10, 256, 4096, -7, {16, 64, 256, 1024});
+
+    benchmark_erbf_updates(10, 10, 4096, 1024, -7, {0.001, 0.01, 0.05});
+
+    benchmark_query_service(10, 256, -7, 16, 1000, 0.0, {1, 2, 4, 8}, 64);
+
+    benchmark_sharded(5, 10, 256, {4096, 16384}, -7, {1, 2, 4, 8});
     return 0;
 }
\ No newline at end of file
@@ -1,5 +1,16 @@
 #include "mpsi_protocol.hpp"
+#include "erbf_cache.hpp"
+#include "blinding_store.hpp"
 #include <chrono>
+#include <thread>
+#include <barrier>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cassert>
+#include <unordered_set>
+#include <pthread.h>
+#include <sched.h>
 
 size_t get_ciphertext_size(const Ciphertext& ct) {
     return NumBytes(ct.c1) + NumBytes(ct.c2);
@@ -23,6 +34,86 @@ std::vector<Ciphertext> compute_erbf(const std::vector<long>& set,
     return erbf;
 }
 
+// Bin l encrypts 1 if the bit is set, a random non-1 value otherwise
+Ciphertext encrypt_bin(bool bit, const Keys& keys) {
+    ZZ m = bit ? to_ZZ(1) : (RandomBnd(keys.params.p - 2) + 2);
+    return encrypt(m, keys.params);
+}
+
+std::vector<Ciphertext> compute_erbf(const CountingBloomFilter& cbf, const Keys& keys) {
+    std::vector<Ciphertext> erbf;
+    erbf.reserve(cbf.counters.size());
+    for (size_t l = 0; l < cbf.counters.size(); l++) 
+        erbf.push_back(encrypt_bin(cbf.contains_bit(l), keys));
+    return erbf;
+}
+
+ErbfUpdate update_erbf(CountingBloomFilter* cbf, 
+                       const std::vector<long>& old_set, 
+                       const std::vector<long>& new_set, 
+                       const Keys& keys) {
+    std::unordered_set<long> old_elements(old_set.begin(), old_set.end());
+    std::unordered_set<long> new_elements(new_set.begin(), new_set.end());
+
+    // Bits of every bin touched by the change, before the change
+    std::unordered_map<size_t, bool> touched;
+    auto apply = [&](long x, bool insert) {
+        for (size_t bin : cbf->bins_of(x)) 
+            touched.emplace(bin, cbf->contains_bit(bin));
+        if (insert) 
+            cbf->insert(x);
+        else 
+            cbf->remove(x);
+    };
+    for (long x : old_set) 
+        if (!new_elements.count(x)) 
+            apply(x, false);
+    for (long x : new_set) 
+        if (!old_elements.count(x)) 
+            apply(x, true);
+
+    ErbfUpdate update;
+    update.set_digest = digest_set(new_set);
+    for (const auto& [bin, old_bit] : touched) {
+        if (cbf->contains_bit(bin) == old_bit) 
+            continue;
+        update.bins.push_back(bin);
+        update.ciphertexts.push_back(encrypt_bin(!old_bit, keys));
+    }
+    return update;
+}
+
+size_t get_erbf_update_size(const ErbfUpdate& update) {
+    size_t size = update.bins.size() * sizeof(uint64_t);
+    for (const auto& ct : update.ciphertexts) 
+        size += get_ciphertext_size(ct);
+    return size;
+}
+
+void apply_erbf_update(std::vector<Ciphertext>& erbf, const ErbfUpdate& update) {
+    for (size_t k = 0; k < update.bins.size(); k++) 
+        erbf[update.bins[k]] = update.ciphertexts[k];
+}
+
+void apply_erbf_update(IncrementalSession* session, 
+                       long client_id, 
+                       const ErbfUpdate& update, 
+                       const BloomFilterParams& bf_params) {
+    apply_erbf_update(session->client_erbfs[client_id], update);
+    session->client_digests[client_id] = update.set_digest;
+
+    std::unordered_set<size_t> flipped(update.bins.begin(), update.bins.end());
+    for (auto it = session->results.begin(); it != session->results.end(); ) {
+        bool stale = false;
+        for (uint64_t seed : bf_params.seeds) 
+            stale = stale || flipped.count(hash_element(it->first, seed) % bf_params.bin_count);
+        if (stale) 
+            it = session->results.erase(it);
+        else 
+            ++it;
+    }
+}
+
 void set_blinding(const std::vector<long>& set, 
                 const Keys& keys, 
                 std::vector<ZZ>& r_js, 
@@ -30,10 +121,9 @@ void set_blinding(const std::vector<long>& set,
     for (long x : set) {
         ZZ r = RandomBnd(keys.params.p - 1) + 1;
         r_js.push_back(r);
-        Ciphertext enc_x = encrypt(to_ZZ(x + 1), keys.params); // avoid encrypting 0
-        Ciphertext enc_r = encrypt(r, keys.params);
-        w_js.push_back({MulMod(enc_x.c1, enc_r.c1, keys.params.p), 
-                        MulMod(enc_x.c2, enc_r.c2, keys.params.p)});
+        // Enc(x + 1) * Enc(r) = Enc((x + 1) * r), so a single encryption suffices
+        ZZ blinded = MulMod(to_ZZ(x + 1), r, keys.params.p); // avoid encrypting 0
+        w_js.push_back(encrypt(blinded, keys.params));
     }
 }
 
@@ -91,6 +181,46 @@ std::vector<long> decrypt_intersection(const std::vector<std::vector<ZZ>>& decry
     return intersection;
 }
 
+std::vector<ZZ> compute_raw_decryption_shares(const std::vector<ZZ>& combined_ciphertexts_c1, 
+                            const ZZ& key_share,
+                            const ZZ& p) {
+    std::vector<ZZ> shares;
+    shares.reserve(combined_ciphertexts_c1.size());
+    for (const auto& c1 : combined_ciphertexts_c1) 
+        shares.push_back(compute_raw_share(c1, key_share, p));
+    return shares;
+}
+
+// Combines the raw shares of whichever t parties responded (0-indexed in responders)
+std::vector<long> decrypt_intersection_threshold(const std::vector<std::vector<ZZ>>& decryption_shares, 
+                                    const std::vector<int>& responders,
+                                    const std::vector<Ciphertext>& combined_ciphertexts,
+                                    const std::vector<long>& server_set,
+                                    const std::vector<ZZ>& r_js,
+                                    const Keys& keys) {
+    assert(keys.threshold >= 1 && keys.threshold <= static_cast<long>(keys.key_shares.size()));
+    assert(static_cast<long>(responders.size()) == keys.threshold);
+    ZZ q = (keys.params.p - 1) / 2;
+    std::vector<int> parties;
+    for (int i : responders) 
+        parties.push_back(i + 1);
+    std::vector<ZZ> lambdas;
+    for (int i : parties) 
+        lambdas.push_back(compute_delta(i, parties, q));
+
+    std::vector<long> intersection;
+    for (size_t j = 0; j < server_set.size(); j++) {
+        ZZ combined_shares = to_ZZ(1);
+        for (size_t r = 0; r < responders.size(); r++) 
+            combined_shares = MulMod(combined_shares, 
+                                     PowerMod(decryption_shares[responders[r]][j], lambdas[r], keys.params.p), 
+                                     keys.params.p);
+        ZZ decrypted = MulMod(combined_ciphertexts[j].c2, InvMod(combined_shares, keys.params.p), keys.params.p);
+        if (decrypted == MulMod(to_ZZ(server_set[j] + 1), r_js[j], keys.params.p)) 
+            intersection.push_back(server_set[j]);
+    }
+    return intersection;
+}
 
 std::vector<long> multiparty_psi(
     const std::vector<std::vector<long>>& client_sets,
@@ -104,7 +234,9 @@ std::vector<long> multiparty_psi(
     size_t* server_sent_bytes, 
     size_t* server_received_bytes,
     size_t* client_sent_bytes,
-    size_t* client_received_bytes
+    size_t* client_received_bytes,
+    ErbfCache* erbf_cache,
+    BlindingStore* blinding_store
 ) {
     using namespace std::chrono;
     int n_clients = client_sets.size();
@@ -114,8 +246,11 @@ std::vector<long> multiparty_psi(
     // Clients compute their ERBFs
     auto start = high_resolution_clock::now();
     std::vector<std::vector<Ciphertext>> all_erbfs;
-    for (const auto& set : client_sets) {
-        all_erbfs.push_back(compute_erbf(set, bf_params, keys));
+    for (int i = 0; i < n_clients; i++) {
+        if (erbf_cache) 
+            all_erbfs.push_back(erbf_cache->get_or_compute(i, client_sets[i], bf_params, keys));
+        else 
+            all_erbfs.push_back(compute_erbf(client_sets[i], bf_params, keys));
     }
     auto stop = high_resolution_clock::now();
     *client_prep_time = duration<double, std::milli>(stop - start).count() / n_clients;
@@ -124,7 +259,8 @@ std::vector<long> multiparty_psi(
     start = high_resolution_clock::now();
     std::vector<ZZ> r_js;
     std::vector<Ciphertext> w_js;
-    set_blinding(server_set, keys, r_js, w_js);
+    if (!blinding_store || !blinding_store->take(server_set, keys.params, r_js, w_js)) 
+        set_blinding(server_set, keys, r_js, w_js);
     stop = high_resolution_clock::now();
     *server_prep_time = duration<double, std::milli>(stop - start).count();
     
@@ -184,5 +320,421 @@ std::vector<long> multiparty_psi(
     stop = high_resolution_clock::now();
     *server_online_time += duration<double, std::milli>(stop - start).count();
 
+    return intersection;
+}
+
+std::vector<std::vector<long>> multiparty_psi_batch(
+    const std::vector<std::vector<long>>& client_sets,
+    const std::vector<std::vector<long>>& server_sets,
+    BloomFilterParams& bf_params,
+    const Keys& keys,
+    double* client_prep_time,
+    size_t* client_erbf_sent_bytes,
+    size_t* server_erbf_received_bytes,
+    std::vector<QueryMetrics>* query_metrics,
+    ErbfCache* erbf_cache
+) {
+    using namespace std::chrono;
+    int n_clients = client_sets.size();
+    int total_parties = n_clients + 1; 
+    size_t n_queries = server_sets.size();
+    query_metrics->assign(n_queries, QueryMetrics());
+
+    // Pre-processing stage
+    // Clients compute their ERBFs once for the whole batch
+    auto start = high_resolution_clock::now();
+    std::vector<std::vector<Ciphertext>> all_erbfs;
+    for (int i = 0; i < n_clients; i++) {
+        if (erbf_cache) 
+            all_erbfs.push_back(erbf_cache->get_or_compute(i, client_sets[i], bf_params, keys));
+        else 
+            all_erbfs.push_back(compute_erbf(client_sets[i], bf_params, keys));
+    }
+    auto stop = high_resolution_clock::now();
+    *client_prep_time = duration<double, std::milli>(stop - start).count() / n_clients;
+
+    // Server blinding
+    std::vector<std::vector<ZZ>> r_js(n_queries);
+    std::vector<std::vector<Ciphertext>> w_js(n_queries);
+    for (size_t k = 0; k < n_queries; k++) {
+        start = high_resolution_clock::now();
+        set_blinding(server_sets[k], keys, r_js[k], w_js[k]);
+        stop = high_resolution_clock::now();
+        (*query_metrics)[k].server_prep_time = duration<double, std::milli>(stop - start).count();
+    }
+
+    // Online stage
+    // Clients send ERBFs to server
+    size_t all_erbfs_size_bytes = 0;
+    for (const auto& erbf : all_erbfs) 
+        for (const auto& ct : erbf) 
+            all_erbfs_size_bytes += get_ciphertext_size(ct);
+    *client_erbf_sent_bytes = all_erbfs_size_bytes / n_clients;
+    *server_erbf_received_bytes = all_erbfs_size_bytes;
+
+    // Server aggregates every query against the same ERBFs
+    std::vector<std::vector<Ciphertext>> combined_ciphertexts(n_queries);
+    std::vector<std::vector<ZZ>> combined_ciphertexts_c1(n_queries);
+    for (size_t k = 0; k < n_queries; k++) {
+        start = high_resolution_clock::now();
+        combined_ciphertexts[k] = aggregate_ciphertexts(server_sets[k], all_erbfs, w_js[k], bf_params, keys);
+        stop = high_resolution_clock::now();
+        (*query_metrics)[k].server_online_time += duration<double, std::milli>(stop - start).count();
+
+        // All queries' c1's travel to the clients in one message
+        size_t combined_ciphertexts_size_bytes = 0;
+        for (const auto& ct : combined_ciphertexts[k]) {
+            combined_ciphertexts_c1[k].push_back(ct.c1);
+            combined_ciphertexts_size_bytes += NumBytes(ct.c1);
+        }
+        (*query_metrics)[k].server_sent_bytes += combined_ciphertexts_size_bytes * n_clients;
+        (*query_metrics)[k].client_received_bytes += combined_ciphertexts_size_bytes;
+    }
+
+    // Each party computes decryption shares for the whole batch
+    ZZ q = (keys.params.p - 1) / 2;
+    std::vector<std::vector<std::vector<ZZ>>> decryption_shares(n_queries, std::vector<std::vector<ZZ>>(total_parties));
+    for (int i = 0; i < total_parties; i++) {
+        for (size_t k = 0; k < n_queries; k++) {
+            start = high_resolution_clock::now();
+            decryption_shares[k][i] = compute_decryption_shares(combined_ciphertexts_c1[k], server_sets[k], 
+                                                keys.key_shares[i], keys.params.p, q, 
+                                                i, total_parties);
+            stop = high_resolution_clock::now();
+            (*query_metrics)[k].client_online_time += duration<double, std::milli>(stop - start).count() / n_clients;
+        }
+    }
+
+    // Clients send all their shares to the server in one message
+    for (size_t k = 0; k < n_queries; k++) {
+        size_t all_shares_size_bytes = 0;
+        for (int i = 0; i < n_clients; i++) 
+            for (const auto& share : decryption_shares[k][i]) 
+                all_shares_size_bytes += NumBytes(share);
+        (*query_metrics)[k].client_sent_bytes += all_shares_size_bytes / n_clients;
+        (*query_metrics)[k].server_received_bytes += all_shares_size_bytes;
+    }
+
+    // Server combines shares and decrypts every query
+    std::vector<std::vector<long>> intersections(n_queries);
+    for (size_t k = 0; k < n_queries; k++) {
+        start = high_resolution_clock::now();
+        intersections[k] = decrypt_intersection(decryption_shares[k], 
+                                                combined_ciphertexts[k],
+                                                server_sets[k], r_js[k],
+                                                total_parties, keys);
+        stop = high_resolution_clock::now();
+        (*query_metrics)[k].server_online_time += duration<double, std::milli>(stop - start).count();
+    }
+
+    return intersections;
+}
+
+std::vector<long> multiparty_psi_incremental(
+    const std::vector<std::vector<long>>& client_sets,
+    const std::vector<long>& server_set,
+    BloomFilterParams& bf_params,
+    const Keys& keys,
+    IncrementalSession* session,
+    double* client_prep_time,
+    double* client_online_time,
+    double* server_prep_time,
+    double* server_online_time,
+    size_t* server_sent_bytes, 
+    size_t* server_received_bytes,
+    size_t* client_sent_bytes,
+    size_t* client_received_bytes,
+    ErbfCache* erbf_cache
+) {
+    using namespace std::chrono;
+    int n_clients = client_sets.size();
+    int total_parties = n_clients + 1; 
+
+    // Any change on the clients' side invalidates all previous results
+    std::vector<uint64_t> client_digests;
+    for (const auto& set : client_sets) 
+        client_digests.push_back(digest_set(set));
+    uint64_t params_digest = digest_params(bf_params);
+    bool fresh_session = session->client_erbfs.empty() || session->client_digests != client_digests || 
+                         session->params_digest != params_digest || session->pk != keys.params.pk;
+
+    // Pre-processing stage
+    // Clients compute and send their ERBFs only when the session starts
+    if (fresh_session) {
+        session->client_digests = client_digests;
+        session->params_digest = params_digest;
+        session->pk = keys.params.pk;
+        session->results.clear();
+        session->client_erbfs.clear();
+
+        auto start = high_resolution_clock::now();
+        for (int i = 0; i < n_clients; i++) {
+            if (erbf_cache) 
+                session->client_erbfs.push_back(erbf_cache->get_or_compute(i, client_sets[i], bf_params, keys));
+            else 
+                session->client_erbfs.push_back(compute_erbf(client_sets[i], bf_params, keys));
+        }
+        auto stop = high_resolution_clock::now();
+        *client_prep_time = duration<double, std::milli>(stop - start).count() / n_clients;
+
+        size_t all_erbfs_size_bytes = 0;
+        for (const auto& erbf : session->client_erbfs) 
+            for (const auto& ct : erbf) 
+                all_erbfs_size_bytes += get_ciphertext_size(ct);
+        *client_sent_bytes += all_erbfs_size_bytes / n_clients;
+        *server_received_bytes += all_erbfs_size_bytes;
+    }
+
+    // Drop removed elements, keep only the added ones for this round
+    std::unordered_set<long> current(server_set.begin(), server_set.end());
+    for (auto it = session->results.begin(); it != session->results.end(); ) {
+        if (!current.count(it->first)) 
+            it = session->results.erase(it);
+        else 
+            ++it;
+    }
+    std::vector<long> added;
+    for (long x : server_set) 
+        if (!session->results.count(x)) 
+            added.push_back(x);
+
+    if (!added.empty()) {
+        // Server blinding
+        auto start = high_resolution_clock::now();
+        std::vector<ZZ> r_js;
+        std::vector<Ciphertext> w_js;
+        set_blinding(added, keys, r_js, w_js);
+        auto stop = high_resolution_clock::now();
+        *server_prep_time = duration<double, std::milli>(stop - start).count();
+
+        // Online stage, over the added elements only
+        start = high_resolution_clock::now();
+        std::vector<Ciphertext> combined_ciphertexts = aggregate_ciphertexts(added, 
+                                                                            session->client_erbfs, w_js, 
+                                                                            bf_params, keys);
+        stop = high_resolution_clock::now();
+        *server_online_time += duration<double, std::milli>(stop - start).count();
+
+        std::vector<ZZ> combined_ciphertexts_c1;
+        size_t combined_ciphertexts_size_bytes = 0;
+        for (const auto& ct : combined_ciphertexts) {  
+            combined_ciphertexts_c1.push_back(ct.c1);
+            combined_ciphertexts_size_bytes += NumBytes(ct.c1);
+        }
+        *server_sent_bytes += combined_ciphertexts_size_bytes * n_clients;
+        *client_received_bytes += combined_ciphertexts_size_bytes;
+
+        ZZ q = (keys.params.p - 1) / 2;
+        std::vector<std::vector<ZZ>> decryption_shares(total_parties);
+        start = high_resolution_clock::now();
+        for (int i = 0; i < total_parties; i++) 
+            decryption_shares[i] = compute_decryption_shares(combined_ciphertexts_c1, added, 
+                                                keys.key_shares[i], keys.params.p, q, 
+                                                i, total_parties);
+        stop = high_resolution_clock::now();
+        *client_online_time += duration<double, std::milli>(stop - start).count() / n_clients;
+
+        size_t all_shares_size_bytes = 0;
+        for (int i = 0; i < n_clients; i++) 
+            for (const auto& share : decryption_shares[i]) 
+                all_shares_size_bytes += NumBytes(share);
+        *client_sent_bytes += all_shares_size_bytes / n_clients;    
+        *server_received_bytes += all_shares_size_bytes;
+
+        start = high_resolution_clock::now();
+        std::vector<long> added_intersection = decrypt_intersection(decryption_shares, 
+                                                                    combined_ciphertexts,
+                                                                    added, r_js,
+                                                                    total_parties, keys);
+        stop = high_resolution_clock::now();
+        *server_online_time += duration<double, std::milli>(stop - start).count();
+
+        for (long x : added) 
+            session->results[x] = false;
+        for (long x : added_intersection) 
+            session->results[x] = true;
+    }
+
+    std::vector<long> intersection;
+    for (long x : server_set) 
+        if (session->results[x]) 
+            intersection.push_back(x);
+    return intersection;
+}
+
+// Pins the calling thread to a single core
+void pin_current_thread(int party) {
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(party % cores, &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpu_set);
+}
+
+std::vector<long> multiparty_psi_concurrent(
+    const std::vector<std::vector<long>>& client_sets,
+    const std::vector<long>& server_set,
+    BloomFilterParams& bf_params,
+    const Keys& keys,
+    const SimulationConfig& config,
+    double* client_prep_time,
+    double* client_online_time,
+    double* server_prep_time,
+    double* server_online_time,
+    size_t* server_sent_bytes, 
+    size_t* server_received_bytes,
+    size_t* client_sent_bytes,
+    size_t* client_received_bytes,
+    std::vector<double>* party_wall_times,
+    double* critical_path_time
+) {
+    using namespace std::chrono;
+    int n_clients = client_sets.size();
+    int total_parties = n_clients + 1; 
+    int server = n_clients; // the server is the last party and holds the last key share
+    ZZ q = (keys.params.p - 1) / 2;
+
+    // Phases end at a message boundary:
+    // 0: clients build ERBFs, server blinds       -> clients send ERBFs
+    // 1: server aggregates                        -> server broadcasts the c1's
+    // 2: every party computes decryption shares   -> clients send shares
+    // 3: server combines shares and decrypts (only needs the responders' shares)
+    const int PHASES = 4;
+    std::vector<std::vector<double>> phase_times(total_parties, std::vector<double>(PHASES, 0.0));
+
+    std::vector<std::vector<Ciphertext>> all_erbfs(n_clients);
+    std::vector<ZZ> r_js;
+    std::vector<Ciphertext> w_js;
+    std::vector<Ciphertext> combined_ciphertexts;
+    std::vector<ZZ> combined_ciphertexts_c1;
+    std::vector<std::vector<ZZ>> decryption_shares(total_parties);
+    std::vector<long> intersection;
+
+    // Shares are collected through a mailbox instead of a barrier, so the server
+    // can continue as soon as enough share vectors arrived
+    if (config.first_t_responders) 
+        assert(keys.threshold >= 1 && keys.threshold <= total_parties);
+    size_t needed_client_shares = config.first_t_responders ? keys.threshold - 1 : n_clients;
+    std::mutex shares_mutex;
+    std::condition_variable shares_arrived;
+    std::vector<int> share_arrivals;
+    std::vector<int> responders;
+
+    std::barrier message_boundary(total_parties);
+    auto party = [&](int i) {
+        if (config.pin_cores) 
+            pin_current_thread(i);
+        seed_thread_rng();
+
+        auto start = high_resolution_clock::now();
+        if (i < n_clients) 
+            all_erbfs[i] = compute_erbf(client_sets[i], bf_params, keys);
+        else 
+            set_blinding(server_set, keys, r_js, w_js);
+        auto stop = high_resolution_clock::now();
+        phase_times[i][0] = duration<double, std::milli>(stop - start).count();
+        message_boundary.arrive_and_wait();
+
+        if (i == server) {
+            start = high_resolution_clock::now();
+            combined_ciphertexts = aggregate_ciphertexts(server_set, all_erbfs, w_js, bf_params, keys);
+            combined_ciphertexts_c1.reserve(combined_ciphertexts.size());
+            for (const auto& ct : combined_ciphertexts) 
+                combined_ciphertexts_c1.push_back(ct.c1);
+            stop = high_resolution_clock::now();
+            phase_times[i][1] = duration<double, std::milli>(stop - start).count();
+        }
+        message_boundary.arrive_and_wait();
+
+        start = high_resolution_clock::now();
+        if (config.first_t_responders) 
+            decryption_shares[i] = compute_raw_decryption_shares(combined_ciphertexts_c1, keys.key_shares[i], keys.params.p);
+        else 
+            decryption_shares[i] = compute_decryption_shares(combined_ciphertexts_c1, server_set, 
+                                                             keys.key_shares[i], keys.params.p, q, 
+                                                             i, total_parties);
+        stop = high_resolution_clock::now();
+        phase_times[i][2] = duration<double, std::milli>(stop - start).count();
+        // The injected latency delays the share vector but is not part of the party's computation
+        if (static_cast<size_t>(i) < config.injected_delays_ms.size() && config.injected_delays_ms[i] > 0) 
+            std::this_thread::sleep_for(duration<double, std::milli>(config.injected_delays_ms[i]));
+        if (i != server) {
+            // Client sends its share vector to the server
+            std::lock_guard<std::mutex> lock(shares_mutex);
+            share_arrivals.push_back(i);
+            shares_arrived.notify_one();
+            return;
+        }
+
+        // Server waits for the share vectors it needs
+        {
+            std::unique_lock<std::mutex> lock(shares_mutex);
+            shares_arrived.wait(lock, [&] { return share_arrivals.size() >= needed_client_shares; });
+            responders.assign(share_arrivals.begin(), share_arrivals.begin() + needed_client_shares);
+        }
+        responders.push_back(server);
+
+        start = high_resolution_clock::now();
+        if (config.first_t_responders) 
+            intersection = decrypt_intersection_threshold(decryption_shares, responders, combined_ciphertexts, 
+                                                          server_set, r_js, keys);
+        else 
+            intersection = decrypt_intersection(decryption_shares, combined_ciphertexts, 
+                                                server_set, r_js, total_parties, keys);
+        stop = high_resolution_clock::now();
+        phase_times[i][3] = duration<double, std::milli>(stop - start).count();
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(total_parties);
+    for (int i = 0; i < total_parties; i++) 
+        threads.emplace_back(party, i);
+    for (auto& thread : threads) 
+        thread.join();
+
+    // Per-party wall times and the critical path (slowest party the server waited for in every phase)
+    std::vector<bool> is_responder(total_parties, false);
+    for (int i : responders) 
+        is_responder[i] = true;
+    party_wall_times->assign(total_parties, 0.0);
+    *critical_path_time = 0.0;
+    for (int phase = 0; phase < PHASES; phase++) {
+        double slowest = 0.0;
+        for (int i = 0; i < total_parties; i++) {
+            (*party_wall_times)[i] += phase_times[i][phase];
+            if (phase != 2 || is_responder[i]) 
+                slowest = std::max(slowest, phase_times[i][phase]);
+        }
+        *critical_path_time += slowest;
+    }
+
+    for (int i = 0; i < n_clients; i++) {
+        *client_prep_time += phase_times[i][0] / n_clients;
+        *client_online_time += phase_times[i][2] / n_clients;
+    }
+    *server_prep_time += phase_times[server][0];
+    *server_online_time += phase_times[server][1] + phase_times[server][2] + phase_times[server][3];
+
+    // Communication is the same as in the sequential simulation
+    size_t all_erbfs_size_bytes = 0;
+    for (const auto& erbf : all_erbfs) 
+        for (const auto& ct : erbf) 
+            all_erbfs_size_bytes += get_ciphertext_size(ct);
+    *client_sent_bytes += all_erbfs_size_bytes / n_clients;
+    *server_received_bytes += all_erbfs_size_bytes;
+
+    size_t combined_ciphertexts_size_bytes = 0;
+    for (const auto& c1 : combined_ciphertexts_c1) 
+        combined_ciphertexts_size_bytes += NumBytes(c1);
+    *server_sent_bytes += combined_ciphertexts_size_bytes * n_clients;
+    *client_received_bytes += combined_ciphertexts_size_bytes;
+
+    size_t all_shares_size_bytes = 0;
+    for (int i = 0; i < n_clients; i++) 
+        for (const auto& share : decryption_shares[i]) 
+            all_shares_size_bytes += NumBytes(share);
+    *client_sent_bytes += all_shares_size_bytes / n_clients;    
+    *server_received_bytes += all_shares_size_bytes;
+
     return intersection;
 }
\ No newline at end of file
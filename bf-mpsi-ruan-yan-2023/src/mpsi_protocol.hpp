@@ -2,10 +2,48 @@
 #define MPSI_PROTOCOL_HPP
 
 #include <vector>
+#include <unordered_map>
 #include <NTL/ZZ.h>
 #include "el_gamal.hpp"
 #include "bloom_filter.hpp"
 
+struct ErbfCache;
+struct BlindingStore;
+
+// Concurrent in-process simulation: every party runs on its own thread and
+// the threads synchronize at the protocol's message boundaries.
+struct SimulationConfig {
+    bool pin_cores = false; // pin party i to core (i mod hardware threads)
+    bool first_t_responders = false; // decrypt with the first keys.threshold share vectors to arrive
+    std::vector<double> injected_delays_ms; // extra latency of client i before its shares arrive
+};
+
+std::vector<Ciphertext> compute_erbf(const std::vector<long>& set, 
+                                    const BloomFilterParams& bf_params, 
+                                    const Keys& keys);
+void set_blinding(const std::vector<long>& set, 
+                  const Keys& keys, 
+                  std::vector<ZZ>& r_js, 
+                  std::vector<Ciphertext>& w_js);
+std::vector<Ciphertext> aggregate_ciphertexts(const std::vector<long>& server_set, 
+                                              const std::vector<std::vector<Ciphertext>>& clients_erbfs, 
+                                              const std::vector<Ciphertext>& w_js,
+                                              const BloomFilterParams& bf_params,
+                                              const Keys& keys);
+std::vector<ZZ> compute_decryption_shares(const std::vector<ZZ>& combined_ciphertexts_c1, 
+                                          const std::vector<long>& server_set, 
+                                          const ZZ& key_share,
+                                          const ZZ& p,
+                                          const ZZ& q,
+                                          int i,
+                                          int total_parties);
+std::vector<long> decrypt_intersection(const std::vector<std::vector<ZZ>>& decryption_shares, 
+                                       const std::vector<Ciphertext>& combined_ciphertexts,
+                                       const std::vector<long>& server_set,
+                                       const std::vector<ZZ>& r_js,
+                                       const int total_parties,
+                                       const Keys& keys);
+
 std::vector<long> multiparty_psi(
     const std::vector<std::vector<long>>& client_sets,
     const std::vector<long>& server_set,
@@ -18,7 +56,101 @@ std::vector<long> multiparty_psi(
     size_t* server_sent_bytes, 
     size_t* server_received_bytes,
     size_t* client_sent_bytes,
-    size_t* client_received_bytes
+    size_t* client_received_bytes,
+    ErbfCache* erbf_cache = nullptr, // clients reuse their ERBFs across queries, client i has id i
+    BlindingStore* blinding_store = nullptr // server loads the blinding of a prepared server set
+);
+
+// Per-query breakdown of a batched session; the ERBF exchange is shared and reported separately
+struct QueryMetrics {
+    double server_prep_time = 0.0;
+    double server_online_time = 0.0;
+    double client_online_time = 0.0;
+    size_t server_sent_bytes = 0;
+    size_t server_received_bytes = 0;
+    size_t client_sent_bytes = 0;
+    size_t client_received_bytes = 0;
+};
+
+// Answers several server sets against one copy of the client ERBFs, with a
+// single round of ciphertexts and decryption shares for the whole batch
+std::vector<std::vector<long>> multiparty_psi_batch(
+    const std::vector<std::vector<long>>& client_sets,
+    const std::vector<std::vector<long>>& server_sets,
+    BloomFilterParams& bf_params,
+    const Keys& keys,
+    double* client_prep_time,
+    size_t* client_erbf_sent_bytes,
+    size_t* server_erbf_received_bytes,
+    std::vector<QueryMetrics>* query_metrics,
+    ErbfCache* erbf_cache = nullptr
+);
+
+// State kept by the server between incremental queries. Results stay valid as
+// long as the client sets, filter parameters and keys are unchanged.
+struct IncrementalSession {
+    std::vector<uint64_t> client_digests;
+    uint64_t params_digest = 0;
+    ZZ pk;
+    std::vector<std::vector<Ciphertext>> client_erbfs; // received in the first session
+    std::unordered_map<long, bool> results; // server element -> in the intersection
+};
+
+// Blinds, aggregates and decrypts only the elements added since the previous
+// query of the session, and drops the removed ones
+std::vector<long> multiparty_psi_incremental(
+    const std::vector<std::vector<long>>& client_sets,
+    const std::vector<long>& server_set,
+    BloomFilterParams& bf_params,
+    const Keys& keys,
+    IncrementalSession* session,
+    double* client_prep_time,
+    double* client_online_time,
+    double* server_prep_time,
+    double* server_online_time,
+    size_t* server_sent_bytes, 
+    size_t* server_received_bytes,
+    size_t* client_sent_bytes,
+    size_t* client_received_bytes,
+    ErbfCache* erbf_cache = nullptr
+);
+
+// Re-encrypted bins of a client whose set changed, only bins whose bit flipped
+struct ErbfUpdate {
+    uint64_t set_digest; // digest of the client's set after the update
+    std::vector<size_t> bins;
+    std::vector<Ciphertext> ciphertexts;
+};
+
+std::vector<Ciphertext> compute_erbf(const CountingBloomFilter& cbf, const Keys& keys);
+ErbfUpdate update_erbf(CountingBloomFilter* cbf, 
+                       const std::vector<long>& old_set, 
+                       const std::vector<long>& new_set, 
+                       const Keys& keys);
+size_t get_erbf_update_size(const ErbfUpdate& update);
+void apply_erbf_update(std::vector<Ciphertext>& erbf, const ErbfUpdate& update);
+// Patches the stored ERBF of a client and forgets the results of server elements on flipped bins
+void apply_erbf_update(IncrementalSession* session, 
+                       long client_id, 
+                       const ErbfUpdate& update, 
+                       const BloomFilterParams& bf_params);
+
+std::vector<long> multiparty_psi_concurrent(
+    const std::vector<std::vector<long>>& client_sets,
+    const std::vector<long>& server_set,
+    BloomFilterParams& bf_params,
+    const Keys& keys,
+    const SimulationConfig& config,
+    double* client_prep_time,
+    double* client_online_time,
+    double* server_prep_time,
+    double* server_online_time,
+    size_t* server_sent_bytes, 
+    size_t* server_received_bytes,
+    size_t* client_sent_bytes,
+    size_t* client_received_bytes,
+    std::vector<double>* party_wall_times, // index n_clients is the server
+    double* critical_path_time
 );
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,330 @@
+#include "query_service.hpp"
+#include <cmath>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+LatencyHistogram::LatencyHistogram(double bucket_ms, size_t bucket_count) 
+    : bucket_ms(bucket_ms), counts(std::max<size_t>(bucket_count, 1), 0) {}
+
+void LatencyHistogram::record(double latency_ms) {
+    size_t bucket = static_cast<size_t>(latency_ms / bucket_ms);
+    counts[std::min(bucket, counts.size() - 1)]++;
+    total++;
+}
+
+double LatencyHistogram::percentile(double percentile) const {
+    if (total == 0) 
+        return 0.0;
+    size_t rank = std::max<size_t>(static_cast<size_t>(std::ceil(percentile / 100.0 * total)), 1);
+    size_t seen = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+        seen += counts[b];
+        if (seen >= rank) 
+            return (b + 1) * bucket_ms;
+    }
+    return counts.size() * bucket_ms;
+}
+
+QueryService::QueryService(std::vector<std::vector<Ciphertext>> client_erbfs, 
+                           std::vector<ShareRequest> client_shares, 
+                           const BloomFilterParams& bf_params, 
+                           const PublicParameters& params, 
+                           const ZZ& server_key_share, 
+                           const std::vector<long>& indexed_elements, 
+                           const ServiceConfig& config)
+    : bf_params(bf_params), params(params), server_key_share(server_key_share), 
+      client_shares(std::move(client_shares)), config(config), 
+      client_erbfs(std::move(client_erbfs)), 
+      latencies(config.histogram_bucket_ms, config.histogram_buckets) {
+    assert(this->client_shares.size() == this->client_erbfs.size());
+    q = (params.p - 1) / 2;
+    long exponent_bits = NumBits(q);
+    g_table = std::make_unique<FixedBaseTable>(params.g, params.p, exponent_bits);
+    pk_table = std::make_unique<FixedBaseTable>(params.pk, params.p, exponent_bits);
+
+    aggregated_erbf.reserve(bf_params.bin_count);
+    for (size_t l = 0; l < bf_params.bin_count; l++) 
+        aggregated_erbf.push_back(aggregate_bin(l));
+
+    bin_index.reserve(indexed_elements.size());
+    for (long x : indexed_elements) 
+        bin_index.emplace(x, compute_bins(x));
+
+    started = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < std::max<size_t>(config.worker_count, 1); i++) 
+        workers.emplace_back(&QueryService::worker_loop, this);
+}
+
+QueryService::~QueryService() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    query_available.notify_all();
+    for (auto& worker : workers) 
+        worker.join();
+}
+
+Ciphertext QueryService::aggregate_bin(size_t bin) const {
+    Ciphertext c = {to_ZZ(1), to_ZZ(1)};
+    for (const auto& erbf : client_erbfs) {
+        c.c1 = MulMod(c.c1, erbf[bin].c1, params.p);
+        c.c2 = MulMod(c.c2, erbf[bin].c2, params.p);
+    }
+    return c;
+}
+
+std::vector<size_t> QueryService::compute_bins(long element) const {
+    std::vector<size_t> bins;
+    bins.reserve(bf_params.seeds.size());
+    for (uint64_t seed : bf_params.seeds) 
+        bins.push_back(hash_element(element, seed) % bf_params.bin_count);
+    return bins;
+}
+
+bool QueryService::submit(const std::vector<long>& elements, std::future<QueryResult>* result) {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    // Admission control: shed load instead of letting the queue grow without bound
+    if (stopping || queue.size() >= config.queue_capacity) {
+        rejected++;
+        return false;
+    }
+    queue.push_back({elements, std::chrono::high_resolution_clock::now(), std::promise<QueryResult>()});
+    *result = queue.back().result.get_future();
+    query_available.notify_one();
+    return true;
+}
+
+bool QueryService::submit_membership(long element, std::future<QueryResult>* result) {
+    return submit({element}, result);
+}
+
+void QueryService::apply_update(long client_id, const ErbfUpdate& update) {
+    std::unique_lock<std::shared_mutex> lock(erbf_mutex);
+    apply_erbf_update(client_erbfs[client_id], update);
+    for (size_t bin : update.bins) 
+        aggregated_erbf[bin] = aggregate_bin(bin);
+}
+
+ServiceStats QueryService::stats() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    double elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - started).count();
+    return {completed, rejected, completed / elapsed, latencies};
+}
+
+void QueryService::worker_loop() {
+    seed_thread_rng();
+    while (true) {
+        Query query;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            query_available.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) 
+                return;
+            query = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        QueryResult result;
+        try {
+            result.intersection = answer(query.elements);
+        } catch (const std::exception&) {
+            query.result.set_exception(std::current_exception());
+            continue;
+        }
+        result.latency_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - query.submitted).count();
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            completed++;
+            latencies.record(result.latency_ms);
+        }
+        query.result.set_value(std::move(result));
+    }
+}
+
+// Same steps as multiparty_psi, with every client's contribution already folded
+// into one ciphertext per bin: k multiplications per element instead of n * k
+std::vector<long> QueryService::answer(const std::vector<long>& elements) {
+    const ZZ& p = params.p;
+    int total_parties = client_erbfs.size() + 1;
+
+    std::vector<ZZ> r_js;
+    std::vector<Ciphertext> combined_ciphertexts;
+    {
+        std::shared_lock<std::shared_mutex> lock(erbf_mutex);
+        for (long x : elements) {
+            ZZ r = RandomBnd(p - 1) + 1;
+            r_js.push_back(r);
+            Ciphertext c_j = encrypt(MulMod(to_ZZ(x + 1), r, p), *g_table, *pk_table); // avoid encrypting 0
+            std::vector<size_t> hashed;
+            const std::vector<size_t>* bins = &hashed;
+            auto indexed = bin_index.find(x);
+            if (indexed != bin_index.end()) 
+                bins = &indexed->second;
+            else 
+                hashed = compute_bins(x);
+            for (size_t idx : *bins) {
+                c_j.c1 = MulMod(c_j.c1, aggregated_erbf[idx].c1, p);
+                c_j.c2 = MulMod(c_j.c2, aggregated_erbf[idx].c2, p);
+            }
+            combined_ciphertexts.push_back(c_j);
+        }
+    }
+
+    std::vector<ZZ> combined_ciphertexts_c1;
+    for (const auto& ct : combined_ciphertexts) 
+        combined_ciphertexts_c1.push_back(ct.c1);
+
+    // Clients are parties 0..n-2 and answer with their own shares, the server is party n-1
+    std::vector<std::vector<ZZ>> decryption_shares(total_parties);
+    for (size_t i = 0; i < client_shares.size(); i++) {
+        decryption_shares[i] = client_shares[i](combined_ciphertexts_c1);
+        if (decryption_shares[i].size() != elements.size()) 
+            throw std::runtime_error("Client " + std::to_string(i) + " returned the wrong number of decryption shares");
+    }
+    decryption_shares[total_parties - 1] = compute_decryption_shares(combined_ciphertexts_c1, elements, 
+                                                                     server_key_share, p, q, 
+                                                                     total_parties - 1, total_parties);
+
+    Keys public_keys;
+    public_keys.params = params;
+    return decrypt_intersection(decryption_shares, combined_ciphertexts, elements, r_js, total_parties, public_keys);
+}
+
+std::vector<ShareRequest> local_share_requests(const Keys& keys, long n_clients) {
+    std::vector<ShareRequest> requests;
+    ZZ q = (keys.params.p - 1) / 2;
+    int total_parties = n_clients + 1;
+    for (int i = 0; i < n_clients; i++) {
+        requests.push_back([key_share = keys.key_shares[i], p = keys.params.p, q, i, total_parties](
+                               const std::vector<ZZ>& combined_ciphertexts_c1) {
+            std::vector<long> positions(combined_ciphertexts_c1.size()); // only the count is used
+            return compute_decryption_shares(combined_ciphertexts_c1, positions, key_share, p, q, i, total_parties);
+        });
+    }
+    return requests;
+}
+
+static std::vector<long> parse_set(const std::string& line) {
+    std::istringstream stream(line);
+    std::vector<long> set;
+    long x;
+    while (stream >> x) 
+        set.push_back(x);
+    if (!stream.eof()) 
+        throw std::runtime_error("Could not parse set: " + line);
+    return set;
+}
+
+void serve_queries(QueryService* service, std::istream& in, std::ostream& out) {
+    // Results are written by a separate thread so reading and submitting never waits on a query
+    std::mutex pending_mutex;
+    std::condition_variable pending_available;
+    std::deque<std::future<QueryResult>> pending; // an invalid future marks a rejected query
+    bool done = false;
+
+    std::thread writer([&] {
+        while (true) {
+            std::future<QueryResult> result;
+            {
+                std::unique_lock<std::mutex> lock(pending_mutex);
+                pending_available.wait(lock, [&] { return done || !pending.empty(); });
+                if (pending.empty()) 
+                    return;
+                result = std::move(pending.front());
+                pending.pop_front();
+            }
+            if (!result.valid()) {
+                out << "rejected" << std::endl;
+                continue;
+            }
+            try {
+                std::vector<long> intersection = result.get().intersection;
+                for (size_t j = 0; j < intersection.size(); j++) 
+                    out << (j > 0 ? " " : "") << intersection[j];
+                out << std::endl;
+            } catch (const std::exception& e) {
+                out << "error: " << e.what() << std::endl;
+            }
+        }
+    });
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::future<QueryResult> result;
+        try {
+            service->submit(parse_set(line), &result);
+        } catch (const std::exception&) {
+            std::promise<QueryResult> failed;
+            failed.set_exception(std::current_exception());
+            result = failed.get_future();
+        }
+        {
+            std::lock_guard<std::mutex> lock(pending_mutex);
+            pending.push_back(std::move(result));
+        }
+        pending_available.notify_one();
+    }
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        done = true;
+    }
+    pending_available.notify_one();
+    writer.join();
+}
+
+int run_query_service(const std::string& client_sets_path, 
+                      const std::string& server_set_path, 
+                      int false_positive_exponent, 
+                      const ServiceConfig& config) {
+    std::ifstream client_sets_file(client_sets_path);
+    std::ifstream server_set_file(server_set_path);
+    if (!client_sets_file || !server_set_file) {
+        std::cerr << "Could not open " << (client_sets_file ? server_set_path : client_sets_path) << std::endl;
+        return 1;
+    }
+    std::vector<std::vector<long>> client_sets;
+    std::vector<long> server_set;
+    std::string line;
+    try {
+        while (std::getline(client_sets_file, line)) 
+            if (line.find_first_not_of(" \t\r") != std::string::npos) 
+                client_sets.push_back(parse_set(line));
+        if (std::getline(server_set_file, line)) 
+            server_set = parse_set(line);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (client_sets.empty()) {
+        std::cerr << "No client sets in " << client_sets_path << std::endl;
+        return 1;
+    }
+
+    long n_clients = client_sets.size();
+    size_t set_size_clients = 1;
+    for (const auto& set : client_sets) 
+        set_size_clients = std::max(set_size_clients, set.size());
+    BloomFilterParams bf_params(set_size_clients, false_positive_exponent);
+    Keys keys;
+    key_gen(&keys, 1024, n_clients + 1, n_clients + 1);
+
+    std::vector<std::vector<Ciphertext>> client_erbfs;
+    for (const auto& set : client_sets) 
+        client_erbfs.push_back(compute_erbf(set, bf_params, keys));
+
+    QueryService service(std::move(client_erbfs), local_share_requests(keys, n_clients), 
+                         bf_params, keys.params, keys.key_shares[n_clients], server_set, config);
+    std::cerr << "Serving " << n_clients << " clients with " << config.worker_count << " workers" << std::endl;
+    serve_queries(&service, std::cin, std::cout);
+
+    ServiceStats stats = service.stats();
+    std::cerr << "Completed: " << stats.completed << ", Rejected: " << stats.rejected 
+              << ", p50: " << stats.latencies.percentile(50) << " ms, p99: " << stats.latencies.percentile(99) << " ms" << std::endl;
+    return 0;
+}
\ No newline at end of file
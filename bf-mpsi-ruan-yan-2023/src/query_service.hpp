@@ -0,0 +1,134 @@
+#ifndef QUERY_SERVICE_HPP
+#define QUERY_SERVICE_HPP
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <NTL/ZZ.h>
+#include "el_gamal.hpp"
+#include "bloom_filter.hpp"
+#include "mpsi_protocol.hpp"
+
+// Fixed-width latency histogram, the last bucket also holds everything above it
+struct LatencyHistogram {
+    double bucket_ms;
+    std::vector<size_t> counts;
+    size_t total = 0;
+
+    LatencyHistogram(double bucket_ms, size_t bucket_count);
+    void record(double latency_ms);
+    double percentile(double percentile) const; // upper edge of the bucket holding the percentile
+};
+
+struct QueryResult {
+    std::vector<long> intersection; // membership queries have a single element
+    double latency_ms; // from submission to completion, including queueing
+};
+
+struct ServiceConfig {
+    size_t worker_count = 4;
+    size_t queue_capacity = 64; // queries beyond this are rejected
+    double histogram_bucket_ms = 1.0;
+    size_t histogram_buckets = 10000;
+};
+
+struct ServiceStats {
+    size_t completed;
+    size_t rejected;
+    double throughput; // completed queries per second since the service started
+    LatencyHistogram latencies;
+};
+
+// Asks one client for its decryption shares of the c1 components of a query.
+// In a deployment this is a round trip to the client, which keeps its key share.
+using ShareRequest = std::function<std::vector<ZZ>(const std::vector<ZZ>& combined_ciphertexts_c1)>;
+
+// Server role kept resident: the per-bin product of all client ERBFs, the server's
+// key share and fixed-base tables for blinding stay in memory, and queries from
+// a bounded local queue are answered by a fixed pool of workers. Client i holds
+// key share i and is asked for its shares through client_shares[i] on every query.
+struct QueryService {
+    // indexed_elements get their bin indices computed once here, other elements are hashed per query
+    QueryService(std::vector<std::vector<Ciphertext>> client_erbfs, 
+                 std::vector<ShareRequest> client_shares, 
+                 const BloomFilterParams& bf_params, 
+                 const PublicParameters& params, 
+                 const ZZ& server_key_share, 
+                 const std::vector<long>& indexed_elements, 
+                 const ServiceConfig& config);
+    ~QueryService();
+    QueryService(const QueryService&) = delete;
+    QueryService& operator=(const QueryService&) = delete;
+
+    // Returns false if the queue is full and the query was rejected
+    bool submit(const std::vector<long>& elements, std::future<QueryResult>* result);
+    bool submit_membership(long element, std::future<QueryResult>* result);
+    // Patches a client's ERBF and the affected bins of the aggregate
+    void apply_update(long client_id, const ErbfUpdate& update);
+    ServiceStats stats() const;
+
+private:
+    struct Query {
+        std::vector<long> elements;
+        std::chrono::high_resolution_clock::time_point submitted;
+        std::promise<QueryResult> result;
+    };
+
+    void worker_loop();
+    std::vector<long> answer(const std::vector<long>& elements);
+    Ciphertext aggregate_bin(size_t bin) const;
+    std::vector<size_t> compute_bins(long element) const;
+
+    BloomFilterParams bf_params;
+    PublicParameters params;
+    ZZ server_key_share;
+    std::vector<ShareRequest> client_shares;
+    ServiceConfig config;
+    ZZ q;
+    std::unique_ptr<FixedBaseTable> g_table;
+    std::unique_ptr<FixedBaseTable> pk_table;
+
+    mutable std::shared_mutex erbf_mutex;
+    std::vector<std::vector<Ciphertext>> client_erbfs;
+    std::vector<Ciphertext> aggregated_erbf; // bin l holds the product of bin l of every client
+    std::unordered_map<long, std::vector<size_t>> bin_index; // read-only after construction
+
+    mutable std::mutex queue_mutex;
+    std::condition_variable query_available;
+    std::deque<Query> queue;
+    bool stopping = false;
+    size_t completed = 0;
+    size_t rejected = 0;
+    LatencyHistogram latencies;
+    std::chrono::high_resolution_clock::time_point started;
+    std::vector<std::thread> workers;
+};
+
+// Share requests answered in-process by clients holding keys.key_shares[0..n_clients-1]
+std::vector<ShareRequest> local_share_requests(const Keys& keys, long n_clients);
+
+// Reads one query per line (whitespace separated elements) until EOF and writes one
+// result line per query in submission order, "rejected" if the queue was full.
+// Queries are submitted as they are read, so several are in flight at once.
+void serve_queries(QueryService* service, std::istream& in, std::ostream& out);
+
+// Resident server process: one client set per line in client_sets_path, the server's
+// own set on one line in server_set_path (its bin indices are precomputed), queries on
+// stdin and results on stdout. The clients are simulated in-process.
+int run_query_service(const std::string& client_sets_path, 
+                      const std::string& server_set_path, 
+                      int false_positive_exponent, 
+                      const ServiceConfig& config);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,612 @@
+#include "sharding.hpp"
+#include "erbf_cache.hpp"
+#include "mpsi_protocol.hpp"
+#include <chrono>
+#include <random>
+#include <memory>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <filesystem>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// Upper bound on a single job or result, anything longer is treated as malformed
+const uint64_t MAX_MESSAGE_BYTES = 1ULL << 30;
+
+// Messages are a little-endian u64 length followed by the payload. Every getter
+// reads between cursor and end and fails instead of running past the end.
+void put_u64(std::vector<unsigned char>& buf, uint64_t value) {
+    for (int b = 0; b < 8; b++) 
+        buf.push_back(static_cast<unsigned char>(value >> (8 * b)));
+}
+
+bool get_u64(const unsigned char*& cursor, const unsigned char* end, uint64_t& value) {
+    if (end - cursor < 8) 
+        return false;
+    value = 0;
+    for (int b = 0; b < 8; b++) 
+        value |= static_cast<uint64_t>(cursor[b]) << (8 * b);
+    cursor += 8;
+    return true;
+}
+
+// A count of items that take at least item_bytes each, so it cannot exceed what is left
+bool get_count(const unsigned char*& cursor, const unsigned char* end, size_t item_bytes, size_t& count) {
+    uint64_t value;
+    if (!get_u64(cursor, end, value) || value > static_cast<uint64_t>(end - cursor) / item_bytes) 
+        return false;
+    count = value;
+    return true;
+}
+
+void put_double(std::vector<unsigned char>& buf, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put_u64(buf, bits);
+}
+
+bool get_double(const unsigned char*& cursor, const unsigned char* end, double& value) {
+    uint64_t bits;
+    if (!get_u64(cursor, end, bits)) 
+        return false;
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+void put_zz(std::vector<unsigned char>& buf, const ZZ& value) {
+    size_t length = NumBytes(value);
+    put_u64(buf, length);
+    size_t offset = buf.size();
+    buf.resize(offset + length);
+    BytesFromZZ(buf.data() + offset, value, length);
+}
+
+bool get_zz(const unsigned char*& cursor, const unsigned char* end, ZZ& value) {
+    size_t length;
+    if (!get_count(cursor, end, 1, length)) 
+        return false;
+    value = ZZFromBytes(cursor, length);
+    cursor += length;
+    return true;
+}
+
+void put_ciphertext(std::vector<unsigned char>& buf, const Ciphertext& ct) {
+    put_zz(buf, ct.c1);
+    put_zz(buf, ct.c2);
+}
+
+bool get_ciphertext(const unsigned char*& cursor, const unsigned char* end, Ciphertext& ct) {
+    return get_zz(cursor, end, ct.c1) && get_zz(cursor, end, ct.c2);
+}
+
+void put_string(std::vector<unsigned char>& buf, const std::string& value) {
+    put_u64(buf, value.size());
+    buf.insert(buf.end(), value.begin(), value.end());
+}
+
+bool get_string(const unsigned char*& cursor, const unsigned char* end, std::string& value) {
+    size_t length;
+    if (!get_count(cursor, end, 1, length)) 
+        return false;
+    value.assign(reinterpret_cast<const char*>(cursor), length);
+    cursor += length;
+    return true;
+}
+
+bool send_all(int fd, const unsigned char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) 
+            return false;
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool recv_all(int fd, unsigned char* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = recv(fd, data, size, 0);
+        if (received <= 0) 
+            return false;
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+bool send_message(int fd, const std::vector<unsigned char>& payload) {
+    std::vector<unsigned char> length;
+    put_u64(length, payload.size());
+    return send_all(fd, length.data(), length.size()) && send_all(fd, payload.data(), payload.size());
+}
+
+bool recv_message(int fd, std::vector<unsigned char>& payload) {
+    unsigned char length[8];
+    if (!recv_all(fd, length, sizeof(length))) 
+        return false;
+    const unsigned char* cursor = length;
+    uint64_t size;
+    if (!get_u64(cursor, length + sizeof(length), size) || size > MAX_MESSAGE_BYTES) 
+        return false;
+    payload.resize(size);
+    return recv_all(fd, payload.data(), payload.size());
+}
+
+// Everything a worker needs is public: the ERBFs, the Bloom filter parameters, the
+// public key, and the shard's elements with their blinded encryptions w_j
+struct AggregationJob {
+    std::vector<std::string> erbf_paths;
+    size_t bin_count;
+    std::vector<uint64_t> seeds;
+    PublicParameters params;
+    std::vector<long> shard;
+    std::vector<Ciphertext> w_js;
+};
+
+std::vector<unsigned char> encode_job(const AggregationJob& job) {
+    std::vector<unsigned char> buf;
+    put_u64(buf, job.erbf_paths.size());
+    for (const auto& path : job.erbf_paths) 
+        put_string(buf, path);
+    put_u64(buf, job.bin_count);
+    put_u64(buf, job.seeds.size());
+    for (uint64_t seed : job.seeds) 
+        put_u64(buf, seed);
+    put_zz(buf, job.params.p);
+    put_zz(buf, job.params.g);
+    put_zz(buf, job.params.pk);
+    put_u64(buf, job.shard.size());
+    for (size_t j = 0; j < job.shard.size(); j++) {
+        put_u64(buf, static_cast<uint64_t>(job.shard[j]));
+        put_ciphertext(buf, job.w_js[j]);
+    }
+    return buf;
+}
+
+// Fails on short payloads and on trailing bytes
+bool decode_job(const std::vector<unsigned char>& buf, AggregationJob& job) {
+    const unsigned char* cursor = buf.data();
+    const unsigned char* end = buf.data() + buf.size();
+    size_t count;
+    if (!get_count(cursor, end, 8, count)) 
+        return false;
+    job.erbf_paths.resize(count);
+    for (auto& path : job.erbf_paths) 
+        if (!get_string(cursor, end, path)) 
+            return false;
+    uint64_t bin_count;
+    if (!get_u64(cursor, end, bin_count) || bin_count == 0 || !get_count(cursor, end, 8, count)) 
+        return false;
+    job.bin_count = bin_count;
+    job.seeds.resize(count);
+    for (auto& seed : job.seeds) 
+        if (!get_u64(cursor, end, seed)) 
+            return false;
+    if (!get_zz(cursor, end, job.params.p) || !get_zz(cursor, end, job.params.g) || 
+        !get_zz(cursor, end, job.params.pk) || job.params.p <= 1) 
+        return false;
+    if (!get_count(cursor, end, 8 + 2 * 8, count)) 
+        return false;
+    job.shard.resize(count);
+    job.w_js.resize(count);
+    for (size_t j = 0; j < count; j++) {
+        uint64_t x;
+        if (!get_u64(cursor, end, x) || !get_ciphertext(cursor, end, job.w_js[j])) 
+            return false;
+        job.shard[j] = static_cast<long>(x);
+    }
+    return cursor == end;
+}
+
+// shares[i][j] is party i's share for element j, only elements begin..end are encoded
+std::vector<unsigned char> encode_shares(const std::vector<std::vector<ZZ>>& shares, size_t begin, size_t end) {
+    std::vector<unsigned char> buf;
+    put_u64(buf, shares.size());
+    put_u64(buf, end - begin);
+    for (size_t j = begin; j < end; j++) 
+        for (const auto& party_shares : shares) 
+            put_zz(buf, party_shares[j]);
+    return buf;
+}
+
+// Decodes into shares[j][i], fails unless there are expected_count elements and every share is in [1, p)
+bool decode_shares(const std::vector<unsigned char>& buf, size_t expected_count, const ZZ& p, 
+                   std::vector<std::vector<ZZ>>& shares) {
+    const unsigned char* cursor = buf.data();
+    const unsigned char* end = buf.data() + buf.size();
+    uint64_t parties;
+    size_t count;
+    if (!get_u64(cursor, end, parties) || parties == 0 || parties > MAX_MESSAGE_BYTES / 8 || 
+        !get_count(cursor, end, 8 * parties, count) || count != expected_count) 
+        return false;
+    shares.assign(count, std::vector<ZZ>(parties));
+    for (auto& element_shares : shares) 
+        for (auto& share : element_shares) 
+            if (!get_zz(cursor, end, share) || share <= 0 || share >= p) 
+                return false;
+    return cursor == end;
+}
+
+// c2 over the product of all parties' shares, (x + 1) * r_j when x is in every client set
+ZZ decrypt_with_shares(const Ciphertext& ct, const std::vector<ZZ>& shares, const ZZ& p) {
+    ZZ combined_shares = to_ZZ(1);
+    for (const auto& share : shares) 
+        combined_shares = MulMod(combined_shares, share, p);
+    return MulMod(ct.c2, InvMod(combined_shares, p), p);
+}
+
+void serve_aggregation_job(int fd) {
+    using namespace std::chrono;
+    std::vector<unsigned char> buf;
+    AggregationJob job;
+    if (!recv_message(fd, buf) || !decode_job(buf, job)) {
+        std::cerr << "Worker received a malformed job" << std::endl;
+        return;
+    }
+
+    // Only ERBFs encrypted under the job's public key are accepted
+    uint64_t key_digest = digest_keys(job.params);
+    std::vector<std::unique_ptr<MappedErbf>> erbfs;
+    for (const auto& path : job.erbf_paths) {
+        erbfs.push_back(std::make_unique<MappedErbf>(path));
+        const MappedErbf& erbf = *erbfs.back();
+        if (!erbf.valid() || erbf.bin_count() != job.bin_count || erbf.header().key_digest != key_digest) {
+            std::cerr << "Worker could not map a client ERBF" << std::endl;
+            return;
+        }
+    }
+
+    // Aggregate the shard, reading bins straight from the mappings
+    auto start = high_resolution_clock::now();
+    const ZZ& p = job.params.p;
+    for (size_t j = 0; j < job.shard.size(); j++) {
+        Ciphertext& c_j = job.w_js[j];
+        for (const auto& erbf : erbfs) {
+            for (uint64_t seed : job.seeds) {
+                Ciphertext bin = erbf->get(hash_element(job.shard[j], seed) % job.bin_count);
+                c_j.c1 = MulMod(c_j.c1, bin.c1, p);
+                c_j.c2 = MulMod(c_j.c2, bin.c2, p);
+            }
+        }
+    }
+    auto stop = high_resolution_clock::now();
+
+    std::vector<unsigned char> result;
+    put_u64(result, job.w_js.size());
+    for (const auto& c_j : job.w_js) 
+        put_ciphertext(result, c_j);
+    put_double(result, duration<double, std::milli>(stop - start).count());
+    if (!send_message(fd, result)) 
+        return;
+
+    // Second round: the parties' decryption shares for the shard, computed by the share
+    // holders from the c1 components sent above. The worker combines them and decrypts,
+    // the coordinator only compares the plaintexts against its blinded elements.
+    std::vector<std::vector<ZZ>> shares;
+    if (!recv_message(fd, buf)) 
+        return; // the coordinator decrypts the shard itself
+    if (!decode_shares(buf, job.shard.size(), p, shares)) {
+        std::cerr << "Worker received malformed decryption shares" << std::endl;
+        return;
+    }
+    start = high_resolution_clock::now();
+    std::vector<ZZ> decrypted;
+    for (size_t j = 0; j < job.shard.size(); j++) 
+        decrypted.push_back(decrypt_with_shares(job.w_js[j], shares[j], p));
+    stop = high_resolution_clock::now();
+
+    result.clear();
+    put_u64(result, decrypted.size());
+    for (const auto& m : decrypted) 
+        put_zz(result, m);
+    put_double(result, duration<double, std::milli>(stop - start).count());
+    send_message(fd, result);
+}
+
+// Fails unless the result holds exactly expected_count ciphertexts and the worker time
+bool decode_result(const std::vector<unsigned char>& buf, size_t expected_count, 
+                   std::vector<Ciphertext>& combined_ciphertexts, double& worker_time) {
+    const unsigned char* cursor = buf.data();
+    const unsigned char* end = buf.data() + buf.size();
+    size_t count;
+    if (!get_count(cursor, end, 2 * 8, count) || count != expected_count) 
+        return false;
+    combined_ciphertexts.resize(count);
+    for (auto& ct : combined_ciphertexts) 
+        if (!get_ciphertext(cursor, end, ct)) 
+            return false;
+    return get_double(cursor, end, worker_time) && cursor == end;
+}
+
+// Fails unless the result holds exactly expected_count plaintexts and the worker time
+bool decode_decrypted(const std::vector<unsigned char>& buf, size_t expected_count, 
+                      std::vector<ZZ>& decrypted, double& worker_time) {
+    const unsigned char* cursor = buf.data();
+    const unsigned char* end = buf.data() + buf.size();
+    size_t count;
+    if (!get_count(cursor, end, 8, count) || count != expected_count) 
+        return false;
+    decrypted.resize(count);
+    for (auto& m : decrypted) 
+        if (!get_zz(cursor, end, m)) 
+            return false;
+    return get_double(cursor, end, worker_time) && cursor == end;
+}
+
+int run_aggregation_worker(const std::string& bind_address, uint16_t port) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* addresses = nullptr;
+    std::string port_string = std::to_string(port);
+    if (getaddrinfo(bind_address.c_str(), port_string.c_str(), &hints, &addresses) != 0) {
+        std::cerr << "Worker could not resolve " << bind_address << std::endl;
+        return 1;
+    }
+    int listener = -1;
+    for (addrinfo* a = addresses; a != nullptr && listener < 0; a = a->ai_next) {
+        listener = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (listener < 0) 
+            continue;
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (bind(listener, a->ai_addr, a->ai_addrlen) < 0 || listen(listener, 16) < 0) {
+            close(listener);
+            listener = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (listener < 0) {
+        std::cerr << "Worker could not listen on " << bind_address << ":" << port << std::endl;
+        return 1;
+    }
+
+    std::cout << "Aggregation worker listening on " << bind_address << ":" << port << std::endl;
+    while (true) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) 
+            continue;
+        serve_aggregation_job(connection);
+        close(connection);
+    }
+}
+
+int connect_to_worker(const std::string& host_port) {
+    size_t colon = host_port.rfind(':');
+    if (colon == std::string::npos) 
+        return -1;
+    std::string host = host_port.substr(0, colon);
+    std::string port = host_port.substr(colon + 1);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) 
+        return -1;
+    int fd = -1;
+    for (addrinfo* a = addresses; a != nullptr && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    return fd;
+}
+
+std::vector<long> multiparty_psi_sharded(
+    const std::vector<std::vector<long>>& client_sets,
+    const std::vector<long>& server_set,
+    BloomFilterParams& bf_params,
+    const Keys& keys,
+    const ShardingConfig& config,
+    double* client_prep_time,
+    double* client_online_time,
+    double* server_prep_time,
+    double* server_online_time,
+    size_t* coordinator_sent_bytes,
+    size_t* coordinator_received_bytes,
+    std::vector<double>* worker_times
+) {
+    using namespace std::chrono;
+    int n_clients = client_sets.size();
+    int total_parties = n_clients + 1;
+    const ZZ& p = keys.params.p;
+    ZZ q = (p - 1) / 2;
+
+    // Pre-processing stage
+    // Clients compute their ERBFs
+    auto start = high_resolution_clock::now();
+    std::vector<std::vector<Ciphertext>> all_erbfs;
+    for (const auto& set : client_sets) 
+        all_erbfs.push_back(compute_erbf(set, bf_params, keys));
+    auto stop = high_resolution_clock::now();
+    *client_prep_time = duration<double, std::milli>(stop - start).count() / n_clients;
+
+    // Server stores the received ERBFs where the workers can map them, in a directory of its own
+    // so that concurrent runs do not overwrite each other's files, and blinds its set itself:
+    // r_js never leave the coordinator
+    start = high_resolution_clock::now();
+    std::ostringstream run_name;
+    run_name << "run_" << getpid() << "_" << std::hex << std::random_device()();
+    std::filesystem::path run_directory = std::filesystem::absolute(config.erbf_directory) / run_name.str();
+    std::filesystem::create_directories(run_directory);
+    uint64_t params_digest = digest_params(bf_params);
+    uint64_t key_digest = digest_keys(keys.params);
+    std::vector<std::string> erbf_paths;
+    for (int i = 0; i < n_clients; i++) {
+        ErbfCacheKey key = {i, digest_set(client_sets[i]), params_digest, key_digest};
+        erbf_paths.push_back((run_directory / ("client_" + std::to_string(i) + ".erbf")).string());
+        if (!write_erbf_file(erbf_paths.back(), key, all_erbfs[i], keys)) {
+            std::filesystem::remove_all(run_directory);
+            throw std::runtime_error("Could not write the client ERBFs to " + run_directory.string());
+        }
+    }
+    std::vector<ZZ> r_js;
+    std::vector<Ciphertext> w_js;
+    set_blinding(server_set, keys, r_js, w_js);
+    stop = high_resolution_clock::now();
+    *server_prep_time = duration<double, std::milli>(stop - start).count();
+
+    // Online stage
+    // Only the server's work counts towards server_online_time: starting the workers,
+    // aggregation, its own decryption shares, decryption and the final comparison
+    start = high_resolution_clock::now();
+    std::vector<int> connections;
+    std::vector<pid_t> children;
+    if (config.remote_workers.empty()) {
+        for (size_t w = 0; w < std::max<size_t>(config.local_workers, 1); w++) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0) {
+                std::cerr << "Could not create a socket pair for worker " << w << std::endl;
+                break;
+            }
+            pid_t pid = fork();
+            if (pid < 0) {
+                std::cerr << "Could not fork worker " << w << std::endl;
+                close(pair[0]);
+                close(pair[1]);
+                break;
+            }
+            if (pid == 0) {
+                for (int fd : connections) 
+                    close(fd);
+                close(pair[0]);
+                serve_aggregation_job(pair[1]);
+                close(pair[1]);
+                _exit(0);
+            }
+            close(pair[1]);
+            connections.push_back(pair[0]);
+            children.push_back(pid);
+        }
+    } else {
+        for (const auto& worker : config.remote_workers) {
+            int fd = connect_to_worker(worker);
+            if (fd < 0) 
+                std::cerr << "Could not connect to worker " << worker << std::endl;
+            else 
+                connections.push_back(fd);
+        }
+    }
+
+    // Contiguous shards of the server set, one per worker
+    size_t n_workers = std::max<size_t>(connections.size(), 1);
+    std::vector<size_t> shard_begin(n_workers + 1);
+    for (size_t w = 0; w <= n_workers; w++) 
+        shard_begin[w] = server_set.size() * w / n_workers;
+    std::vector<bool> alive(n_workers, false);
+    for (size_t w = 0; w < connections.size(); w++) {
+        AggregationJob job;
+        job.erbf_paths = erbf_paths;
+        job.bin_count = bf_params.bin_count;
+        job.seeds = bf_params.seeds;
+        job.params = keys.params;
+        job.shard.assign(server_set.begin() + shard_begin[w], server_set.begin() + shard_begin[w + 1]);
+        job.w_js.assign(w_js.begin() + shard_begin[w], w_js.begin() + shard_begin[w + 1]);
+        std::vector<unsigned char> buf = encode_job(job);
+        alive[w] = send_message(connections[w], buf);
+        *coordinator_sent_bytes += buf.size() + 8;
+    }
+
+    // Collect the aggregated ciphertexts in server set order. A shard whose worker failed or
+    // sent a malformed result is aggregated by the coordinator itself, never dropped.
+    std::vector<Ciphertext> combined_ciphertexts;
+    combined_ciphertexts.reserve(server_set.size());
+    worker_times->assign(n_workers, 0.0);
+    for (size_t w = 0; w < n_workers; w++) {
+        std::vector<Ciphertext> shard_ciphertexts;
+        std::vector<unsigned char> result;
+        size_t shard_size = shard_begin[w + 1] - shard_begin[w];
+        alive[w] = alive[w] && recv_message(connections[w], result) && 
+                   decode_result(result, shard_size, shard_ciphertexts, (*worker_times)[w]);
+        if (w < connections.size()) 
+            *coordinator_received_bytes += result.size() + 8;
+        if (!alive[w]) {
+            if (w < connections.size()) 
+                std::cerr << "Worker " << w << " failed, aggregating its shard locally" << std::endl;
+            auto local_start = high_resolution_clock::now();
+            std::vector<long> shard(server_set.begin() + shard_begin[w], server_set.begin() + shard_begin[w + 1]);
+            std::vector<Ciphertext> shard_w_js(w_js.begin() + shard_begin[w], w_js.begin() + shard_begin[w + 1]);
+            shard_ciphertexts = aggregate_ciphertexts(shard, all_erbfs, shard_w_js, bf_params, keys);
+            (*worker_times)[w] = duration<double, std::milli>(high_resolution_clock::now() - local_start).count();
+        }
+        combined_ciphertexts.insert(combined_ciphertexts.end(), shard_ciphertexts.begin(), shard_ciphertexts.end());
+    }
+    stop = high_resolution_clock::now();
+    double server_time = duration<double, std::milli>(stop - start).count();
+
+    // Server sends the c1's to the clients, each computes its decryption shares with its own key share
+    std::vector<ZZ> combined_ciphertexts_c1;
+    for (const auto& ct : combined_ciphertexts) 
+        combined_ciphertexts_c1.push_back(ct.c1);
+    std::vector<std::vector<ZZ>> decryption_shares(total_parties);
+    start = high_resolution_clock::now();
+    for (int i = 0; i < n_clients; i++) 
+        decryption_shares[i] = compute_decryption_shares(combined_ciphertexts_c1, server_set, 
+                                                         keys.key_shares[i], p, q, 
+                                                         i, total_parties);
+    stop = high_resolution_clock::now();
+    *client_online_time = duration<double, std::milli>(stop - start).count() / n_clients;
+
+    // Server adds its own shares and hands each shard's shares to its worker, which decrypts
+    // the shard. The coordinator compares the plaintexts against (x + 1) * r_j.
+    start = high_resolution_clock::now();
+    decryption_shares[n_clients] = compute_decryption_shares(combined_ciphertexts_c1, server_set, 
+                                                             keys.key_shares[n_clients], p, q, 
+                                                             n_clients, total_parties);
+    for (size_t w = 0; w < connections.size(); w++) {
+        if (!alive[w]) 
+            continue;
+        std::vector<unsigned char> buf = encode_shares(decryption_shares, shard_begin[w], shard_begin[w + 1]);
+        alive[w] = send_message(connections[w], buf);
+        *coordinator_sent_bytes += buf.size() + 8;
+    }
+    std::vector<long> intersection;
+    for (size_t w = 0; w < n_workers; w++) {
+        std::vector<ZZ> decrypted;
+        std::vector<unsigned char> result;
+        size_t shard_size = shard_begin[w + 1] - shard_begin[w];
+        double decryption_time = 0.0;
+        bool received = alive[w] && recv_message(connections[w], result) && 
+                        decode_decrypted(result, shard_size, decrypted, decryption_time);
+        if (alive[w]) 
+            *coordinator_received_bytes += result.size() + 8;
+        if (!received) {
+            if (alive[w]) 
+                std::cerr << "Worker " << w << " failed, decrypting its shard locally" << std::endl;
+            auto local_start = high_resolution_clock::now();
+            decrypted.clear();
+            for (size_t j = shard_begin[w]; j < shard_begin[w + 1]; j++) {
+                std::vector<ZZ> element_shares;
+                for (const auto& party_shares : decryption_shares) 
+                    element_shares.push_back(party_shares[j]);
+                decrypted.push_back(decrypt_with_shares(combined_ciphertexts[j], element_shares, p));
+            }
+            decryption_time = duration<double, std::milli>(high_resolution_clock::now() - local_start).count();
+        }
+        (*worker_times)[w] += decryption_time;
+        for (size_t j = shard_begin[w]; j < shard_begin[w + 1]; j++) 
+            if (decrypted[j - shard_begin[w]] == MulMod(to_ZZ(server_set[j] + 1), r_js[j], p)) 
+                intersection.push_back(server_set[j]);
+    }
+    stop = high_resolution_clock::now();
+    server_time += duration<double, std::milli>(stop - start).count();
+    *server_online_time = server_time;
+
+    for (int fd : connections) 
+        close(fd);
+    for (pid_t child : children) 
+        waitpid(child, nullptr, 0);
+    std::filesystem::remove_all(run_directory);
+
+    return intersection;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef SHARDING_HPP
+#define SHARDING_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <NTL/ZZ.h>
+#include "el_gamal.hpp"
+#include "bloom_filter.hpp"
+
+// Coordinator/worker mode: the server blinds its set and splits it into contiguous
+// shards, each worker maps the client ERBFs read-only, aggregates its shard and
+// sends back the combined ciphertexts. Once the parties have computed their
+// decryption shares, each worker combines its shard's shares and decrypts it.
+// Workers only see public data and shares, the blinding factors and key shares
+// stay with the coordinator and the parties.
+struct ShardingConfig {
+    size_t local_workers = 4; // forked worker processes, used when remote_workers is empty
+    std::vector<std::string> remote_workers; // "host:port" of workers started with --worker
+    std::string erbf_directory = "../data/erbf_shards"; // each run writes to its own subdirectory, must be visible to remote workers at the same path
+};
+
+std::vector<long> multiparty_psi_sharded(
+    const std::vector<std::vector<long>>& client_sets,
+    const std::vector<long>& server_set,
+    BloomFilterParams& bf_params,
+    const Keys& keys,
+    const ShardingConfig& config,
+    double* client_prep_time,
+    double* client_online_time,
+    double* server_prep_time,
+    double* server_online_time,
+    size_t* coordinator_sent_bytes,
+    size_t* coordinator_received_bytes,
+    std::vector<double>* worker_times
+);
+
+// Serves one job on a connected socket: aggregation, then decryption of the shard
+void serve_aggregation_job(int fd);
+// Accepts coordinators on bind_address:port until the process is killed
+int run_aggregation_worker(const std::string& bind_address, uint16_t port);
+
+#endif
\ No newline at end of file
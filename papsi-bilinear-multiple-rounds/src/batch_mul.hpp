@@ -0,0 +1,15 @@
+#ifndef BATCH_MUL_HPP
+#define BATCH_MUL_HPP
+
+#include <cstddef>
+#include <vector>
+#include <mcl/bn.hpp>
+
+using namespace mcl::bn;
+
+// out[i] = points[i]^scalar for a run of points sharing one scalar. The multiplications run on
+// the thread pool (G1::mul applies the GLV split and recodes the scalar itself), and all results
+// are brought to affine form with a single batched inversion, so later serialization is free.
+void batch_mul_G1(std::vector<G1>& out, const std::vector<G1>& points, const Fr& scalar, size_t thread_count = 0);
+
+#endif
\ No newline at end of file
@@ -1,4 +1,9 @@
 #include "bloom_filter.hpp"
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 
 #define XXH_INLINE_ALL
 #include "xxhash.h"
@@ -11,7 +16,10 @@ size_t hash_element(const size_t& element, uint64_t seed) {
     return static_cast<size_t>(hash);
 }
 
-BloomFilterParams::BloomFilterParams(size_t element_count, int64_t e_pow, GT base_gt) {
+BloomFilterParams::BloomFilterParams(size_t element_count, int64_t e_pow, GT base_gt, PairingCurve curve) {
+    if (curve != selected_curve()) 
+        throw std::logic_error("Bloom filter parameters requested on " + curve_name(curve) + " but pairings are set up on " + curve_name(selected_curve()));
+
     // k = - ln(epsilon) / ln(2), since epsilon = 2^e_pow, k = -e_pow
     size_t hash_count = static_cast<size_t>(-e_pow);
 
@@ -28,6 +36,52 @@ BloomFilterParams::BloomFilterParams(size_t element_count, int64_t e_pow, GT bas
         this->seeds.push_back(static_cast<uint64_t>(rand()) + 1); 
     }
     this->base_gt = base_gt; 
+    this->curve = curve;
+}
+
+GTFixedBaseTable::GTFixedBaseTable(const GT& base, size_t window_bits) {
+    this->window_bits = window_bits;
+    size_t window_count = (Fr::getBitSize() + window_bits - 1) / window_bits;
+    size_t digit_count = size_t(1) << window_bits;
+
+    GT window_base = base; // base^(2^(window_bits * i))
+    windows.resize(window_count);
+    for (size_t i = 0; i < window_count; i++) {
+        windows[i].resize(digit_count);
+        windows[i][0] = 1;
+        for (size_t d = 1; d < digit_count; d++) 
+            GT::mul(windows[i][d], windows[i][d - 1], window_base);
+        // base^(d_max + 1) is the base of the next window
+        GT::mul(window_base, windows[i][digit_count - 1], window_base);
+    }
+}
+
+void GTFixedBaseTable::pow(GT& out, const Fr& exponent) const {
+    std::vector<uint8_t> bytes(Fr::getByteSize() + 8, 0); // zero padded past the top window
+    exponent.getLittleEndian(bytes.data(), bytes.size());
+
+    out = 1;
+    size_t digit_mask = (size_t(1) << window_bits) - 1;
+    for (size_t i = 0; i < windows.size(); i++) {
+        size_t bit = i * window_bits;
+        // window_bits <= 8, so a digit spans at most two bytes
+        size_t digit = bytes[bit / 8] | (static_cast<size_t>(bytes[bit / 8 + 1]) << 8);
+        digit = (digit >> (bit % 8)) & digit_mask;
+        if (digit != 0) 
+            GT::mul(out, out, windows[i][digit]);
+    }
+}
+
+const GTFixedBaseTable& cached_fixed_base_table(const GT& base) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::unique_ptr<GTFixedBaseTable>> tables;
+
+    std::string key = base.serializeToHexStr();
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<GTFixedBaseTable>& table = tables[key];
+    if (!table) 
+        table = std::make_unique<GTFixedBaseTable>(base);
+    return *table;
 }
 
 GarbledBloomFilter::GarbledBloomFilter(const BloomFilterParams& params) {
@@ -35,13 +89,14 @@ GarbledBloomFilter::GarbledBloomFilter(const BloomFilterParams& params) {
     this->bins.resize(params.bin_count);
     this->is_empty.resize(params.bin_count, true);
     this->base_gt = params.base_gt;
+    this->share_table = &cached_fixed_base_table(params.base_gt);
 }
 
 GT GarbledBloomFilter::generate_random_share() const {
     Fr r;
     r.setByCSPRNG();
     GT random_share;
-    GT::pow(random_share, base_gt, r); // base_gt^r = random GT element
+    share_table->pow(random_share, r); // base_gt^r = random GT element
     return random_share;
 }
 
@@ -51,7 +106,7 @@ bool GarbledBloomFilter::insert_set(const std::vector<long>& elements, const std
     
     for (size_t i = 0; i < elements.size(); i++) {
         long element = elements[i];
-        GT finalShare = targets[i]; 
+        GT other_shares = 1; // product of the element's bins other than emptySlot
         long emptySlot = -1;
         std::unordered_set<size_t> visited_bins;
 
@@ -65,27 +120,23 @@ bool GarbledBloomFilter::insert_set(const std::vector<long>& elements, const std
                 if (emptySlot == -1) {
                     emptySlot = static_cast<long>(j); 
                 } else {
-                    GT new_share = generate_random_share();
-                    bins[j] = new_share;
+                    bins[j] = generate_random_share();
                     is_empty[j] = false;
-                    
-                    // finalShare = finalShare * (new_share)^-1
-                    GT inv_share;
-                    GT::inv(inv_share, new_share);
-                    GT::mul(finalShare, finalShare, inv_share);
+                    GT::mul(other_shares, other_shares, bins[j]);
                 }
             } else {
-                // finalShare = finalShare * (bins[j])^-1
-                GT inv_share;
-                GT::inv(inv_share, bins[j]);
-                GT::mul(finalShare, finalShare, inv_share);
+                GT::mul(other_shares, other_shares, bins[j]);
             }
         }
 
         if (emptySlot == -1) 
             elements_not_inserted++;
         else {
-            bins[emptySlot] = finalShare;
+            // finalShare = target * (other_shares)^-1, the shares are in the cyclotomic subgroup 
+            // so the inverse is the conjugate
+            GT inv_shares;
+            GT::unitaryInv(inv_shares, other_shares);
+            GT::mul(bins[emptySlot], targets[i], inv_shares);
             is_empty[emptySlot] = false;
         }
     }
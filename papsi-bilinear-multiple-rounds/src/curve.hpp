@@ -0,0 +1,30 @@
+#ifndef CURVE_HPP
+#define CURVE_HPP
+
+#include <cstddef>
+#include <string>
+#include <mcl/bn.hpp>
+
+// Pairing-friendly curves the protocol can be set up on. mcl implements BN254 and BLS12-381,
+// BLS12-377 is listed so that selecting it fails with a clear error instead of a silent fallback.
+enum class PairingCurve { BN254, BLS12_381, BLS12_377 };
+
+PairingCurve parse_curve(const std::string& name); // "BN254", "BLS12-381", "BLS12-377", throws std::invalid_argument otherwise
+std::string curve_name(PairingCurve curve);
+
+// initPairing on the curve, throws std::invalid_argument if mcl does not implement it
+void select_curve(PairingCurve curve);
+PairingCurve selected_curve();
+
+// Wire sizes in bytes of one element on the selected curve (compressed points)
+struct CurveSizes {
+    size_t fr;
+    size_t g1;
+    size_t g2;
+    size_t gt;
+    size_t gt_compressed;
+};
+
+CurveSizes curve_sizes();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,18 @@
+#ifndef GT_COMPRESSION_HPP
+#define GT_COMPRESSION_HPP
+
+#include <cstdint>
+#include <vector>
+#include <mcl/bn.hpp>
+
+using namespace mcl::bn;
+
+// Torus (T2) compression of GT elements for the wire format. GT lies in the cyclotomic subgroup
+// of Fp12 = Fp6[w] / (w^2 - v), so x = a + b w has norm a^2 - b^2 v = 1 and is determined by
+// c = (1 + a) / b in Fp6: 6 Fp values instead of 12. The identity is sent as c = 0.
+size_t compressed_gt_size();
+
+std::vector<uint8_t> serialize_gts_compressed(const std::vector<GT>& xs);
+bool deserialize_gts_compressed(const std::vector<uint8_t>& buffer, std::vector<GT>& xs); // returns false on malformed input
+
+#endif
\ No newline at end of file
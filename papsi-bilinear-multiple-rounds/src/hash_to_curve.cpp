@@ -0,0 +1,72 @@
+#include "hash_to_curve.hpp"
+#include "parallel.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+static const char H1_DOMAIN[] = "MPSI-H1-ID_S";
+static const char H2_DOMAIN[] = "MPSI-H2";
+static const size_t H1_DOMAIN_SIZE = sizeof(H1_DOMAIN) - 1;
+static const size_t H2_DOMAIN_SIZE = sizeof(H2_DOMAIN) - 1;
+static const size_t MAX_G1_BYTES = 128;
+
+void hash_to_G1(G1& h, long element) {
+    uint8_t buffer[H1_DOMAIN_SIZE + sizeof(uint64_t)];
+    std::memcpy(buffer, H1_DOMAIN, H1_DOMAIN_SIZE);
+    uint64_t value = static_cast<uint64_t>(element);
+    for (size_t i = 0; i < sizeof(uint64_t); i++) 
+        buffer[H1_DOMAIN_SIZE + i] = static_cast<uint8_t>(value >> (8 * i)); // same bytes on every host
+    hashAndMapToG1(h, buffer, sizeof(buffer));
+}
+
+G1 hash_to_G1(long element) {
+    G1 h;
+    hash_to_G1(h, element);
+    return h;
+}
+
+std::vector<G1> hash_to_G1_batch(const std::vector<long>& elements, size_t thread_count) {
+    std::vector<G1> points(elements.size());
+    parallel_for(elements.size(), thread_count, [&](size_t i) {
+        hash_to_G1(points[i], elements[i]);
+    });
+    return points;
+}
+
+void h2(G1& h, const G1& point) {
+    uint8_t buffer[H2_DOMAIN_SIZE + MAX_G1_BYTES];
+    std::memcpy(buffer, H2_DOMAIN, H2_DOMAIN_SIZE);
+    size_t point_size = point.serialize(buffer + H2_DOMAIN_SIZE, MAX_G1_BYTES);
+    hashAndMapToG1(h, buffer, H2_DOMAIN_SIZE + point_size);
+}
+
+G1 h2(const G1& point) {
+    G1 h;
+    h2(h, point);
+    return h;
+}
+
+H1Cache::H1Cache(size_t thread_count) {
+    this->thread_count = thread_count;
+}
+
+void H1Cache::insert_batch(const std::vector<long>& elements) {
+    std::vector<long> missing;
+    for (long element : elements) {
+        if (points.count(element) == 0) 
+            missing.push_back(element);
+    }
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+    std::vector<G1> hashed = hash_to_G1_batch(missing, thread_count);
+    for (size_t i = 0; i < missing.size(); i++) 
+        points.emplace(missing[i], hashed[i]);
+}
+
+const G1& H1Cache::get(long element) {
+    auto it = points.find(element);
+    if (it != points.end()) 
+        return it->second;
+    return points.emplace(element, hash_to_G1(element)).first->second;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef JUDGE_SERVICE_HPP
+#define JUDGE_SERVICE_HPP
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <map>
+#include <utility>
+#include <cstdint>
+#include <unordered_set>
+#include <mcl/bn.hpp>
+
+using namespace mcl::bn;
+
+// Fixed-width latency histogram, the last bucket also holds everything above it
+struct LatencyHistogram {
+    double bucket_ms;
+    std::vector<size_t> counts;
+    size_t total = 0;
+
+    LatencyHistogram(double bucket_ms, size_t bucket_count);
+    void record(double latency_ms);
+    double percentile(double percentile) const; // upper edge of the bucket holding the percentile
+};
+
+struct AuthorizationResult {
+    bool authorized; // false if the challenge was unknown or the EEA proof failed
+    std::vector<G1> signatures; // one per blinded element, in order, empty unless authorized
+    double latency_ms; // from submission to completion, including batching
+};
+
+struct JudgeServiceConfig {
+    double batch_window_ms = 1.0; // how long a batch waits for requests from other servers
+    size_t max_batch_requests = 64;
+    int challenge_percent = 20; // share of each server's elements covered by the EEA challenge
+    size_t max_pending_challenges = 1024; // the oldest unanswered challenges are dropped first
+    double histogram_bucket_ms = 1.0;
+    size_t histogram_buckets = 10000;
+};
+
+struct JudgeServiceStats {
+    size_t requests;
+    size_t rejected;
+    size_t batches;
+    LatencyHistogram latencies;
+};
+
+// Judge role kept resident: requests that arrive within one batch window, from any number of
+// servers, are verified and signed together in one parallel run. A server first registers its
+// set and blinded elements and gets a challenge, then submits the EEA proof for it; nothing is
+// signed unless the proof verifies against the registered elements. Signatures H2(H1(x)^r)^{sk}
+// are not cached, every session draws a fresh r so a blinded point never repeats, and keeping r
+// across sessions would let the judge link a server's resubmitted elements.
+struct JudgeService {
+    JudgeService(const Fr& judge_sk, const JudgeServiceConfig& config);
+    ~JudgeService();
+    JudgeService(const JudgeService&) = delete;
+    JudgeService& operator=(const JudgeService&) = delete;
+
+    // Returns the id to submit the proof under, each challenge can be answered once
+    uint64_t issue_challenge(const std::vector<long>& server_set, const std::vector<G1>& blind_xs, 
+                             std::unordered_set<int>* challenge);
+    std::future<AuthorizationResult> submit(uint64_t challenge_id, const std::pair<Fr, Fr>& eea_proof, 
+                                            const std::vector<G1>& tis);
+    // Blocks until verified, empty if rejected
+    std::vector<G1> authorize(uint64_t challenge_id, const std::pair<Fr, Fr>& eea_proof, const std::vector<G1>& tis);
+    JudgeServiceStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Challenge {
+        std::vector<long> server_set;
+        std::vector<G1> blind_xs;
+        std::unordered_set<int> indices;
+    };
+    struct Request {
+        bool issued; // the challenge id was pending
+        Challenge challenge;
+        std::pair<Fr, Fr> eea_proof;
+        std::vector<G1> tis;
+        Clock::time_point submitted;
+        std::promise<AuthorizationResult> result;
+    };
+
+    void dispatcher_loop();
+    void serve_batch(std::vector<Request>& batch);
+
+    Fr judge_sk;
+    JudgeServiceConfig config;
+
+    mutable std::mutex queue_mutex;
+    std::condition_variable request_available;
+    std::deque<Request> queue;
+    std::map<uint64_t, Challenge> pending_challenges; // ordered by id, so oldest first
+    uint64_t next_challenge_id = 0;
+    bool stopping = false;
+    size_t requests = 0;
+    size_t rejected = 0;
+    size_t batches = 0;
+    LatencyHistogram latencies;
+    std::thread dispatcher;
+};
+
+#endif
\ No newline at end of file
@@ -2,7 +2,14 @@
 #include <chrono>
 #include <string>
 #include <random>
+#include <iostream>
+#include <stdexcept>
 #include <mcl/bn.hpp>
+#include "pairing_engine.hpp"
+#include "parallel.hpp"
+#include "gt_compression.hpp"
+#include "hash_to_curve.hpp"
+#include "batch_mul.hpp"
 
 using namespace std;
 using namespace mcl::bn;
@@ -33,22 +40,7 @@ string random_string(size_t length) {
     return random_string;
 }
 
-G1 hash_to_G1(long element) {
-    G1 h;
-    std::string s = std::to_string(element) + "_ID_S";
-    hashAndMapToG1(h, s.c_str(), s.size());
-    return h;
-}
-
-// H2: G1 -> G1
-G1 h2(const G1& element) {
-    G1 h;
-    string s = element.serializeToHexStr();
-    hashAndMapToG1(h, s.c_str(), s.size());
-    return h;
-}
-
-Fr server_blinding(const vector<long>& server_set, vector<G1>& blind_xs) {
+Fr server_blinding(const vector<long>& server_set, vector<G1>& blind_xs, H1Cache& h1_cache) {
     Fr r;
     r.setHashOf(random_string(32)); 
     
@@ -57,10 +49,11 @@ Fr server_blinding(const vector<long>& server_set, vector<G1>& blind_xs) {
     blind_xs.resize(server_set.size());
 
     // Server blinds its elements with r
-    for (size_t i = 0; i < server_set.size(); i++) {
-        G1 h1_x = hash_to_G1(server_set[i]);
-        G1::mul(blind_xs[i], h1_x, r); // H1(x)^r
-    }
+    h1_cache.insert_batch(server_set);
+    vector<G1> h1_xs(server_set.size());
+    for (size_t i = 0; i < server_set.size(); i++) 
+        h1_xs[i] = h1_cache.get(server_set[i]);
+    batch_mul_G1(blind_xs, h1_xs, r); // H1(x)^r
     return r;
 }
 
@@ -74,14 +67,14 @@ unordered_set<int> judge_challenge(const vector<long>& server_set, int p_fractio
     return I;
 }
 
-pair<Fr, Fr> generate_eea_proof(const vector<long>& server_set, Fr r, const unordered_set<int>& I, vector<G1>& tis) {
+pair<Fr, Fr> generate_eea_proof(const vector<long>& server_set, Fr r, const unordered_set<int>& I, vector<G1>& tis, H1Cache& h1_cache) {
     Fr random_eea;
     random_eea.setHashOf(random_string(32));
     int c_eea = 0;
     
     for (size_t i = 0; i < server_set.size(); i++) {
         if (I.count(i)) {
-            G1 h1_x = hash_to_G1(server_set[i]); // H1(x)
+            const G1& h1_x = h1_cache.get(server_set[i]); // H1(x), hashed during blinding
             G1::mul(tis[i], h1_x, random_eea); // t_i = H1(x)^z
         }
     }
@@ -97,69 +90,91 @@ pair<Fr, Fr> generate_eea_proof(const vector<long>& server_set, Fr r, const unor
     return make_pair(c_tmp, s_eea);
 }
 
-void verify_eea_proof(const vector<long>& server_set, 
+// One EEA check: t_i + H1(x)^{c*r} == H1(x)^s
+bool verify_eea_item(const G1& h1_x, const G1& blind_x, const G1& ti, const pair<Fr, Fr>& eea_proof) {
+    G1 right; 
+    G1::mul(right, h1_x, eea_proof.second); // H1(x)^s
+
+    G1 check;
+    G1::mul(check, blind_x, eea_proof.first); // H1(x)^{c*r}
+    G1 left = ti + check; // t_i + H1(x)^{c*r}
+    return left == right; // projective comparison
+}
+
+bool verify_eea_proof(const vector<long>& server_set, 
                       const unordered_set<int>& I, 
                       pair<Fr, Fr> eea_proof, 
                       const vector<G1>& blind_xs,
                       const vector<G1>& tis) {
-    hash<string> std_hash;
+    vector<size_t> challenged;
+    vector<long> challenged_xs;
     for (size_t i = 0; i < server_set.size(); i++) {
         if (I.count(i)) {
-            G1 h1_x = hash_to_G1(server_set[i]); // H1(x)
-            Fr c_tmp = eea_proof.first;
-            Fr s_eea = eea_proof.second;
-
-            G1 right; 
-            G1::mul(right, h1_x, s_eea); // H1(x)^s
-
-            G1 check;
-            G1::mul(check, blind_xs[i], c_tmp); // H1(x)^{c*r}
-            G1 left = tis[i] + check; // t_i + H1(x)^{c*r}
-            
-            if (left.serializeToHexStr() != right.serializeToHexStr()) {
-                cout << "Judge: EEA Verification fails for item " << i << "\n";
-            }
+            challenged.push_back(i);
+            challenged_xs.push_back(server_set[i]);
+        }
+    }
+    if (challenged.empty()) 
+        return true;
+    vector<G1> h1_xs = hash_to_G1_batch(challenged_xs); // H1(x)
+
+    // All checks at once with random weights d_i: 
+    // sum d_i * t_i + sum (c * d_i) * H1(x)^r - sum (s * d_i) * H1(x) == 0
+    size_t n = challenged.size();
+    vector<G1> points(3 * n);
+    vector<Fr> scalars(3 * n);
+    for (size_t k = 0; k < n; k++) {
+        Fr d;
+        d.setByCSPRNG();
+        points[k] = tis[challenged[k]];
+        scalars[k] = d;
+        points[n + k] = blind_xs[challenged[k]];
+        Fr::mul(scalars[n + k], eea_proof.first, d);
+        points[2 * n + k] = h1_xs[k];
+        Fr::mul(scalars[2 * n + k], eea_proof.second, d);
+        Fr::neg(scalars[2 * n + k], scalars[2 * n + k]);
+    }
+    G1 combined;
+    G1::mulVec(combined, points.data(), scalars.data(), points.size());
+    if (combined.isZero()) 
+        return true;
+
+    // The batch failed, check the items one by one to locate the bad ones
+    for (size_t k = 0; k < n; k++) {
+        size_t i = challenged[k];
+        if (!verify_eea_item(h1_xs[k], blind_xs[i], tis[i], eea_proof)) {
+            cout << "Judge: EEA Verification fails for item " << i << "\n";
         }
     }
+    return false;
 }
 
 vector<G1> judge_sign(const vector<G1>& blind_xs, const Fr& judge_sk) {
-    vector<G1> signatures(blind_xs.size());
-    for (size_t i = 0; i < blind_xs.size(); i++) {
-        G1 h2_blind = h2(blind_xs[i]); // H2(H1(x)^r)
-        G1 sign;
-        G1::mul(sign, h2_blind, judge_sk); // sigma = H2(H1(x)^r)^{sk}
-        signatures[i] = sign;
-    }
+    vector<G1> h2_blinds(blind_xs.size());
+    parallel_for(blind_xs.size(), 0, [&](size_t i) {
+        h2(h2_blinds[i], blind_xs[i]); // H2(H1(x)^r)
+    });
+    vector<G1> signatures;
+    batch_mul_G1(signatures, h2_blinds, judge_sk); // sigma = H2(H1(x)^r)^{sk}
     return signatures;
 }
 
 Fr oprf_request(const vector<long>& client_set, vector<G1>& oprf_requests) {
     Fr t;
     t.setHashOf(random_string(32));
-    oprf_requests.resize(client_set.size());
-    for (size_t i = 0; i < client_set.size(); i++) {
-        G1 h1_x = hash_to_G1(client_set[i]);
-        oprf_requests[i] = h1_x; // H1(x)
-        G1::mul(oprf_requests[i], oprf_requests[i], t); // H1(x)^t
-    }
+    vector<G1> h1_xs = hash_to_G1_batch(client_set); // H1(x)
+    batch_mul_G1(oprf_requests, h1_xs, t); // H1(x)^t
     return t;
 }
 
 void oprf_eval(const vector<G1>& oprf_requests, const Fr& server_r, vector<G1>& oprf_evals) {
-    oprf_evals.resize(oprf_requests.size());
-    for (size_t i = 0; i < oprf_requests.size(); i++) {
-        G1::mul(oprf_evals[i], oprf_requests[i], server_r); // H1(x)^{t*r}
-    }
+    batch_mul_G1(oprf_evals, oprf_requests, server_r); // H1(x)^{t*r}
 }
 
 void oprf_recover(const vector<G1>& oprf_evals, const Fr& t, vector<G1>& oprf_recovered) {
     Fr inv_t;
     Fr::inv(inv_t, t);
-    oprf_recovered.resize(oprf_evals.size());
-    for (size_t i = 0; i < oprf_evals.size(); i++) {
-        G1::mul(oprf_recovered[i], oprf_evals[i], inv_t); // H1(x)^r
-    }
+    batch_mul_G1(oprf_recovered, oprf_evals, inv_t); // H1(x)^r
 }
 
 GarbledBloomFilter compute_gbf(const vector<long>& set, 
@@ -167,17 +182,17 @@ GarbledBloomFilter compute_gbf(const vector<long>& set,
                                      const BloomFilterParams& bf_params, 
                                      const Fr& s_i,
                                      const G2& pk) {
-    vector<GT> targets;
-    for (size_t i = 0; i < set.size(); i++) {
+    // the per-element pipeline runs in parallel against the cached precomputed pk
+    const PairingEngine& pk_engine = cached_pairing_engine(pk);
+    vector<GT> targets(set.size());
+    parallel_for(set.size(), pk_engine.thread_count, [&](size_t i) {
         G1 h2_oprf = h2(oprf_elements[i]); // H2(H1(x)^r)
         
         G1 h2_oprf_si;
         G1::mul(h2_oprf_si, h2_oprf, s_i); 
         
-        GT target;
-        pairing(target, h2_oprf_si, pk); // e(H2(H1(x)^r)^{s_i}, pk)
-        targets.push_back(target);
-    }
+        pk_engine.pair(targets[i], h2_oprf_si); // e(H2(H1(x)^r)^{s_i}, pk)
+    });
 
     GarbledBloomFilter gbf(bf_params);
     gbf.insert_set(set, targets);
@@ -198,17 +213,76 @@ std::vector<GT> aggregate_gbfs(const std::vector<GarbledBloomFilter>& gbfs,
     return aggregated_gbf;
 }
 
+std::vector<GT> tree_aggregate_gbfs(
+    const std::vector<GarbledBloomFilter>& gbfs,
+    const std::vector<std::vector<uint8_t>>& wire_gbfs,
+    const std::vector<G2>& S_values,
+    int fan_out,
+    G2* S_agg,
+    double* critical_path_time,
+    size_t* total_sent_bytes,
+    size_t* root_received_bytes
+) {
+    using namespace std::chrono;
+    struct Node {
+        std::vector<GT> bins;
+        std::vector<uint8_t> wire; // what the node forwards to its group leader
+        G2 S;
+    };
+    std::vector<Node> level;
+    for (size_t i = 0; i < gbfs.size(); i++) 
+        level.push_back({gbfs[i].bins, wire_gbfs[i], S_values[i]});
+
+    // Every group of fan_out nodes sends its aggregate to the first node of the group,
+    // the leader client is always the first node, so it ends up as the root
+    while (level.size() > 1) {
+        bool root_level = level.size() <= static_cast<size_t>(fan_out);
+        std::vector<Node> next_level;
+        double slowest_group = 0.0;
+        for (size_t leader = 0; leader < level.size(); leader += fan_out) {
+            auto start = high_resolution_clock::now();
+            Node aggregated = std::move(level[leader]);
+            for (size_t child = leader + 1; child < std::min(leader + fan_out, level.size()); child++) {
+                std::vector<GT> child_bins;
+                if (!deserialize_gts_compressed(level[child].wire, child_bins) || 
+                    child_bins.size() != aggregated.bins.size()) 
+                    throw std::runtime_error("Malformed GBF from tree node " + std::to_string(child));
+                for (size_t v = 0; v < aggregated.bins.size(); v++) 
+                    GT::mul(aggregated.bins[v], aggregated.bins[v], child_bins[v]);
+                G2::add(aggregated.S, aggregated.S, level[child].S);
+
+                size_t child_bytes = level[child].wire.size() + get_element_size(level[child].S);
+                *total_sent_bytes += child_bytes;
+                // the leader client is node 0 at every level, so it also receives below the root
+                if (leader == 0) 
+                    *root_received_bytes += child_bytes;
+            }
+            if (!root_level) 
+                aggregated.wire = serialize_gts_compressed(aggregated.bins);
+            auto stop = high_resolution_clock::now();
+            slowest_group = std::max(slowest_group, duration<double, std::milli>(stop - start).count());
+            next_level.push_back(std::move(aggregated));
+        }
+        *critical_path_time += slowest_group;
+        level = std::move(next_level);
+    }
+    *S_agg = level[0].S;
+    return std::move(level[0].bins);
+}
+
 std::vector<long> intersect(const std::vector<long>& server_set,
                             const std::vector<G1>& judge_signatures,
                             const G2& S_agg,
                             const std::vector<GT>& aggregated_gbf, 
                             const BloomFilterParams& bf_params) {
     std::vector<long> intersection;
+
+    // \hat{x}_j = e(\sigma_j, S_{agg}), S_{agg} is shared by all elements
+    PairingEngine engine(S_agg);
+    std::vector<GT> expected_targets = engine.pair_batch(judge_signatures);
     
     for (size_t j = 0; j < server_set.size(); j++) {
-        // \hat{x}_j = e(\sigma_j, S_{agg})
-        GT expected_target;
-        pairing(expected_target, judge_signatures[j], S_agg);
+        const GT& expected_target = expected_targets[j];
 
         // \hat{y}_j = \prod GBF_{agg}[h_u(x)]
         GT actual_target;
@@ -250,7 +324,8 @@ std::vector<long> multiparty_psi(
     size_t* leader_client_sent_bytes,
     size_t* leader_client_received_bytes,
     size_t* judge_sent_bytes,
-    size_t* judge_received_bytes
+    size_t* judge_received_bytes,
+    int fan_out
 ) {
     using namespace std::chrono;
     int n_clients = client_sets.size();
@@ -259,7 +334,8 @@ std::vector<long> multiparty_psi(
     // Server blinds its set 
     auto server_blind_start = high_resolution_clock::now();
     vector<G1> blind_xs;
-    Fr r = server_blinding(server_set, blind_xs);
+    H1Cache server_h1_cache; // the server maps each of its elements to G1 once per session
+    Fr r = server_blinding(server_set, blind_xs, server_h1_cache);
     auto server_blind_stop = high_resolution_clock::now();
     *server_authorize_time += duration<double, std::milli>(server_blind_stop - server_blind_start).count();
 
@@ -282,7 +358,7 @@ std::vector<long> multiparty_psi(
     //Server generates EEA proof for the challenged items
     vector<G1> tis(server_set.size());
     auto server_eea_start = high_resolution_clock::now();
-    pair<Fr, Fr> eea_proof = generate_eea_proof(server_set, r, challenge_indices, tis);
+    pair<Fr, Fr> eea_proof = generate_eea_proof(server_set, r, challenge_indices, tis, server_h1_cache);
     auto server_eea_stop = high_resolution_clock::now();
     *server_authorize_time += duration<double, std::milli>(server_eea_stop - server_eea_start).count();
 
@@ -293,11 +369,18 @@ std::vector<long> multiparty_psi(
     // Judge verifies EEA proof and computes signatures for the blinded set if the proof is valid
     auto judge_verify_and_sign_start = high_resolution_clock::now();
     vector<G1> judge_signatures;
-    verify_eea_proof(server_set, challenge_indices, eea_proof, blind_xs, tis);
-    judge_signatures = judge_sign(blind_xs, judge_sk);
+    bool eea_proof_valid = verify_eea_proof(server_set, challenge_indices, eea_proof, blind_xs, tis);
+    if (eea_proof_valid) 
+        judge_signatures = judge_sign(blind_xs, judge_sk);
     auto judge_verify_and_sign_stop = high_resolution_clock::now();
     *judge_computation_time += duration<double, std::milli>(judge_verify_and_sign_stop - judge_verify_and_sign_start).count();
 
+    // The judge refuses to authorize a server whose blinded set fails the proof, so the session ends here
+    if (!eea_proof_valid) {
+        std::cerr << "Judge rejected the server's EEA proof, no signatures issued" << std::endl;
+        return {};
+    }
+
     // Judge sends signatures to server
     for(const auto& sigma : judge_signatures) {
         *judge_sent_bytes += get_element_size(sigma); 
@@ -369,6 +452,7 @@ std::vector<long> multiparty_psi(
     auto client_start = high_resolution_clock::now();
     std::vector<G2> S_values;
     std::vector<GarbledBloomFilter> gbfs;
+    std::vector<std::vector<uint8_t>> wire_gbfs; // T2-compressed bins, as sent to the leader
     G2 g2_gen; 
     mapToG2(g2_gen, 1);
 
@@ -384,45 +468,68 @@ std::vector<long> multiparty_psi(
         
         // GBF
         gbfs.push_back(compute_gbf(client_sets[i], clients_blinded_oprf_elements[i], bf_params, s_i, judge_pk));
+        wire_gbfs.push_back(serialize_gts_compressed(gbfs.back().bins));
     }
     auto client_stop = high_resolution_clock::now();
     *client_computation_time = duration<double, std::milli>(client_stop - client_start).count() / n_clients;
     *leader_client_computation_time = duration<double, std::milli>(client_stop - client_start).count() / n_clients;
 
-    // Each client sends their S value and GBF to the leader client (client 1)
-    size_t total_gbf_and_s_values_bytes = 0;
-    for (size_t i = 1; i < n_clients; i++) {
-        total_gbf_and_s_values_bytes += get_element_size(S_values[i]);
-        for (const auto& bin : gbfs[i].bins) 
-            total_gbf_and_s_values_bytes += get_element_size(bin);
-    }
-    if (n_clients > 1) {
-        *client_sent_bytes += total_gbf_and_s_values_bytes / (n_clients - 1);
-        *leader_client_received_bytes += total_gbf_and_s_values_bytes;
-    }
+    std::vector<GT> aggregated_gbf;
+    G2 S_agg;
+    std::vector<uint8_t> wire_aggregated_gbf;
+    if (fan_out > 1) {
+        // Clients multiply their GBFs and add their S values up a tree rooted at the leader client
+        size_t tree_sent_bytes = 0;
+        double critical_path_time = 0.0;
+        aggregated_gbf = tree_aggregate_gbfs(gbfs, wire_gbfs, S_values, fan_out, &S_agg, 
+                                             &critical_path_time, &tree_sent_bytes, leader_client_received_bytes);
+        if (n_clients > 1) 
+            *client_sent_bytes += tree_sent_bytes / (n_clients - 1);
+
+        auto leader_start = high_resolution_clock::now();
+        wire_aggregated_gbf = serialize_gts_compressed(aggregated_gbf);
+        auto leader_stop = high_resolution_clock::now();
+        *leader_client_computation_time = critical_path_time + duration<double, std::milli>(leader_stop - leader_start).count();
+    } else {
+        // Each client sends their S value and GBF to the leader client (client 1)
+        size_t total_gbf_and_s_values_bytes = 0;
+        for (size_t i = 1; i < n_clients; i++) {
+            total_gbf_and_s_values_bytes += get_element_size(S_values[i]);
+            total_gbf_and_s_values_bytes += wire_gbfs[i].size();
+        }
+        if (n_clients > 1) {
+            *client_sent_bytes += total_gbf_and_s_values_bytes / (n_clients - 1);
+            *leader_client_received_bytes += total_gbf_and_s_values_bytes;
+        }
     
-    // The leader client aggregates the S values and GBFs
-    auto leader_start = high_resolution_clock::now();
-    std::vector<GT> aggregated_gbf = aggregate_gbfs(gbfs, n_clients, bf_params);
-    G2 S_agg; 
-    S_agg.clear(); 
-    for (const auto& S_i : S_values) {
-        G2::add(S_agg, S_agg, S_i); // exponent multiplications
+        // The leader client aggregates the S values and GBFs
+        auto leader_start = high_resolution_clock::now();
+        for (int i = 1; i < n_clients; i++) {
+            if (!deserialize_gts_compressed(wire_gbfs[i], gbfs[i].bins) || gbfs[i].bins.size() != bf_params.bin_count) 
+                throw std::runtime_error("Malformed GBF from client " + std::to_string(i + 1));
+        }
+        aggregated_gbf = aggregate_gbfs(gbfs, n_clients, bf_params);
+        S_agg.clear(); 
+        for (const auto& S_i : S_values) {
+            G2::add(S_agg, S_agg, S_i); // exponent multiplications
+        }
+        wire_aggregated_gbf = serialize_gts_compressed(aggregated_gbf);
+        auto leader_stop = high_resolution_clock::now();
+        *leader_client_computation_time = duration<double, std::milli>(leader_stop - leader_start).count();
     }
-    auto leader_stop = high_resolution_clock::now();
-    *leader_client_computation_time = duration<double, std::milli>(leader_stop - leader_start).count();
 
     // The leader client sends the aggregated S and GBFs to the server
-    for (const auto& bin : aggregated_gbf) {
-        *leader_client_sent_bytes += get_element_size(bin);
-        *server_received_bytes += get_element_size(bin);
-    }
+    *leader_client_sent_bytes += wire_aggregated_gbf.size();
+    *server_received_bytes += wire_aggregated_gbf.size();
     *leader_client_sent_bytes += get_element_size(S_agg);
     *server_received_bytes += get_element_size(S_agg);
 
     // The server computes the intersection
     auto server_start = high_resolution_clock::now();
-    std::vector<long> intersection = intersect(server_set, judge_signatures, S_agg, aggregated_gbf, bf_params);
+    std::vector<GT> received_gbf;
+    if (!deserialize_gts_compressed(wire_aggregated_gbf, received_gbf) || received_gbf.size() != bf_params.bin_count) 
+        throw std::runtime_error("Malformed aggregated GBF from the leader client");
+    std::vector<long> intersection = intersect(server_set, judge_signatures, S_agg, received_gbf, bf_params);
     auto server_stop = high_resolution_clock::now();
     *server_intersect_time = duration<double, std::milli>(server_stop - server_start).count();
 
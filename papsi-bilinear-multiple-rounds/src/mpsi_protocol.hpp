@@ -2,8 +2,28 @@
 #define MPSI_PROTOCOL_HPP
 
 #include <vector>
+#include <cstdint>
+#include <utility>
+#include <unordered_set>
 #include <NTL/ZZ.h>
 #include "bloom_filter.hpp"
+#include "hash_to_curve.hpp"
+
+// Judge signatures H2(H1(x)^r)^{sk} over the server's blinded set
+std::vector<G1> judge_sign(const std::vector<G1>& blind_xs, const Fr& judge_sk);
+
+// Authorization round: the server blinds its set with a fresh r, the judge challenges roughly
+// p_fraction percent of the positions, and the server proves with one EEA proof (c, s) and
+// t_i = H1(x_i)^z that the challenged blinded points are H1(x_i)^r. tis needs one slot per element.
+Fr server_blinding(const std::vector<long>& server_set, std::vector<G1>& blind_xs, H1Cache& h1_cache);
+std::unordered_set<int> judge_challenge(const std::vector<long>& server_set, int p_fraction);
+std::pair<Fr, Fr> generate_eea_proof(const std::vector<long>& server_set, Fr r, const std::unordered_set<int>& I, 
+                                     std::vector<G1>& tis, H1Cache& h1_cache);
+bool verify_eea_proof(const std::vector<long>& server_set, 
+                      const std::unordered_set<int>& I, 
+                      std::pair<Fr, Fr> eea_proof, 
+                      const std::vector<G1>& blind_xs,
+                      const std::vector<G1>& tis);
 
 std::vector<long> multiparty_psi(
     const std::vector<std::vector<long>>& client_sets,
@@ -24,7 +44,22 @@ std::vector<long> multiparty_psi(
     size_t* leader_client_sent_bytes,
     size_t* leader_client_received_bytes,
     size_t* judge_sent_bytes,
-    size_t* judge_received_bytes
+    size_t* judge_received_bytes,
+    int fan_out = 0 // > 1: clients aggregate their GBFs in a tree of this fan-out instead of all sending to the leader
+);
+
+// Bin-wise product of the clients' GBFs and sum of their S values over a tree with the given
+// fan-out, rooted at the leader client (client 0). Aggregates travel T2-compressed. Every level's
+// groups work in parallel, so the critical path is the sum of the slowest group of each level.
+std::vector<GT> tree_aggregate_gbfs(
+    const std::vector<GarbledBloomFilter>& gbfs,
+    const std::vector<std::vector<uint8_t>>& wire_gbfs,
+    const std::vector<G2>& S_values,
+    int fan_out,
+    G2* S_agg,
+    double* critical_path_time,
+    size_t* total_sent_bytes,
+    size_t* root_received_bytes
 );
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,11 @@
+#include "batch_mul.hpp"
+#include "parallel.hpp"
+
+void batch_mul_G1(std::vector<G1>& out, const std::vector<G1>& points, const Fr& scalar, size_t thread_count) {
+    std::vector<G1> projective(points.size());
+    parallel_for(points.size(), thread_count, [&](size_t i) {
+        G1::mul(projective[i], points[i], scalar);
+    });
+    out.resize(points.size());
+    G1::normalizeVec(out.data(), projective.data(), projective.size());
+}
\ No newline at end of file
@@ -7,6 +7,11 @@
 #include <unistd.h>
 #include <fstream>
 #include <filesystem>
+#include "judge_service.hpp"
+#include "hash_to_curve.hpp"
+#include "batch_mul.hpp"
+#include <future>
+#include <stdexcept>
 
 // https://github.com/jellevos/bitset_mpsi/blob/master/main.cpp
 std::vector<long> sample_set(long set_size, long domain_size) {
@@ -65,8 +70,8 @@ double sample_std_communication(const std::vector<size_t>& measurements, double
     return std::sqrt(sum / (measurements.size() - 1.0));
 }
 
-GT setup_pairings() {
-    initPairing(); 
+GT setup_pairings(PairingCurve curve) {
+    select_curve(curve); 
 
     // generator in G2
     G2 g2_gen;
@@ -83,7 +88,9 @@ GT setup_pairings() {
     return base_gt;
 }
 
-void setup_judge_keys(mcl::bn::G2& judge_pk, mcl::bn::Fr& judge_sk) {
+void setup_judge_keys(mcl::bn::G2& judge_pk, mcl::bn::Fr& judge_sk, PairingCurve curve) {
+    if (curve != selected_curve()) 
+        throw std::logic_error("Judge keys requested on " + curve_name(curve) + " but pairings are set up on " + curve_name(selected_curve()));
     judge_sk.setByCSPRNG();
     mcl::bn::G2 g2_gen;
     mapToG2(g2_gen, 1);
@@ -353,4 +360,360 @@ void benchmark(long repetitions, std::vector<long> number_of_parties_list, long
                 << time_network_2 << "," 
                 << time_network_3 << "\n";
     }
+}
+
+void benchmark_tree_aggregation(long repetitions, std::vector<long> number_of_parties_list, long set_size_clients, long set_size_server, 
+                                int p_fraction, int false_positive_exponent, std::vector<int> fan_outs) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream tree_csv("../data/tree_aggregation.csv");
+    tree_csv << "Parties,Fan-out,Leader Client Online,Client Sent,Leader Client Received\n";
+
+    GT base_gt = setup_pairings();
+    BloomFilterParams params(set_size_clients, false_positive_exponent, base_gt); 
+    mcl::bn::G2 judge_pk;
+    mcl::bn::Fr judge_sk;
+    setup_judge_keys(judge_pk, judge_sk);
+
+    for (long t : number_of_parties_list) {
+        // fan-out 0 is the direct topology, every client sends its GBF to the leader client
+        for (int fan_out : fan_outs) {
+            std::cout << "\nBenchmarking " << t << " parties, fan-out " << fan_out << std::endl;
+
+            std::vector<long> leader_online_times;
+            std::vector<size_t> client_sent_bytes_all, leader_client_received_bytes_all;
+            for (int i = 0; i < repetitions; ++i) {
+                std::vector<std::vector<long>> client_sets;
+                std::vector<long> server_set;
+                generate_clients_and_server_sets(t - 1, set_size_clients, set_size_server, 
+                    domain_size, forced_intersection_size, client_sets, server_set);
+
+                double client_computation_time = 0.0;
+                double leader_client_computation_time = 0.0;
+                double server_authorize_time = 0.0;
+                double server_intersect_time = 0.0;
+                double judge_computation_time = 0.0;
+                size_t server_sent_bytes = 0;
+                size_t server_received_bytes = 0;
+                size_t client_sent_bytes = 0;
+                size_t client_received_bytes = 0;
+                size_t leader_client_sent_bytes = 0;
+                size_t leader_client_received_bytes = 0;
+                size_t judge_sent_bytes = 0;
+                size_t judge_received_bytes = 0;
+
+                std::vector<long> result = multiparty_psi(
+                    client_sets, 
+                    server_set, 
+                    params, 
+                    judge_pk,
+                    judge_sk,
+                    p_fraction,
+                    &client_computation_time,
+                    &leader_client_computation_time,
+                    &server_authorize_time,
+                    &server_intersect_time,
+                    &judge_computation_time,
+                    &server_sent_bytes,
+                    &server_received_bytes,
+                    &client_sent_bytes,
+                    &client_received_bytes,
+                    &leader_client_sent_bytes,
+                    &leader_client_received_bytes,
+                    &judge_sent_bytes,
+                    &judge_received_bytes,
+                    fan_out
+                );
+
+                std::vector<long> expected = compute_intersection_non_private(client_sets, server_set);
+                std::cout << "Expected size: " << expected.size() << ", MPSI size: " << result.size();
+                std::cout << ", Leader client: " << leader_client_computation_time << " ms, " << leader_client_received_bytes << " bytes received" << std::endl;
+
+                leader_online_times.push_back(static_cast<long>(leader_client_computation_time));
+                client_sent_bytes_all.push_back(client_sent_bytes);
+                leader_client_received_bytes_all.push_back(leader_client_received_bytes);
+            }
+
+            tree_csv << t << "," 
+                    << fan_out << ","
+                    << sample_mean_computation(leader_online_times) << ","
+                    << sample_mean_communication(client_sent_bytes_all) << ","
+                    << sample_mean_communication(leader_client_received_bytes_all) << "\n";
+        }
+    }
+}
+
+void benchmark_gbf_construction(long repetitions, std::vector<long> set_sizes, int false_positive_exponent) {
+    long long domain_size = (1LL << 32) - 1;
+    GT base_gt = setup_pairings();
+
+    std::cout << "\nBenchmarking GT garbled Bloom filter construction, k=" << -false_positive_exponent << std::endl;
+    for (long set_size : set_sizes) {
+        BloomFilterParams params(set_size, false_positive_exponent, base_gt); 
+        std::vector<long> pow_share_times;
+        std::vector<long> table_share_times;
+        std::vector<long> insert_set_times;
+        long failed_lookups = 0;
+
+        for (int i = 0; i < repetitions; ++i) {
+            std::vector<long> set = sample_set(set_size, domain_size);
+            GarbledBloomFilter gbf(params);
+
+            // one share per bin, as a full exponentiation and through the fixed-base table
+            std::vector<Fr> exponents(params.bin_count);
+            for (Fr& r : exponents) 
+                r.setByCSPRNG();
+            GT share;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (const Fr& r : exponents) 
+                GT::pow(share, base_gt, r);
+            auto stop = std::chrono::high_resolution_clock::now();
+            pow_share_times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count());
+
+            start = std::chrono::high_resolution_clock::now();
+            for (const Fr& r : exponents) 
+                gbf.share_table->pow(share, r);
+            stop = std::chrono::high_resolution_clock::now();
+            table_share_times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count());
+
+            std::vector<GT> targets;
+            targets.reserve(set.size());
+            for (size_t j = 0; j < set.size(); j++) 
+                targets.push_back(gbf.generate_random_share());
+            start = std::chrono::high_resolution_clock::now();
+            gbf.insert_set(set, targets);
+            stop = std::chrono::high_resolution_clock::now();
+            insert_set_times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(stop - start).count());
+
+            for (size_t j = 0; j < set.size(); j++) 
+                if (!gbf.contains(set[j], targets[j])) 
+                    failed_lookups++;
+        }
+
+        double mean_pow = sample_mean_computation(pow_share_times) / 1000.0;
+        double mean_table = sample_mean_computation(table_share_times) / 1000.0;
+        double mean_insert_set = sample_mean_computation(insert_set_times) / 1000.0;
+        std::cout << "n=" << set_size << ", m=" << params.bin_count
+                  << ": m shares with GT::pow (ms) " << std::fixed << mean_pow
+                  << ", fixed-base table (ms) " << mean_table
+                  << "; insert_set (ms) " << mean_insert_set
+                  << "; failed lookups " << failed_lookups << std::endl;
+    }
+}
+
+void benchmark_judge_service(long rounds, std::vector<long> server_counts, long set_size_server, int p_fraction) {
+    long long domain_size = (1LL << 32) - 1;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream service_csv("../data/judge_service.csv");
+    service_csv << "Servers,Rounds,Set Size,Requests,Rejected,Batches,Sequential Total,Service Total,P50,P90,P99\n";
+
+    setup_pairings();
+    mcl::bn::G2 judge_pk;
+    mcl::bn::Fr judge_sk;
+    setup_judge_keys(judge_pk, judge_sk);
+
+    for (long server_count : server_counts) {
+        std::cout << "\nBenchmarking judge service, " << server_count << " servers" << std::endl;
+        JudgeServiceConfig config;
+        config.histogram_bucket_ms = 0.1;
+        config.challenge_percent = p_fraction;
+        JudgeService service(judge_sk, config);
+
+        std::vector<std::vector<long>> server_sets(server_count);
+        for (auto& set : server_sets) 
+            set = sample_set(set_size_server, domain_size);
+
+        double sequential_ms = 0.0;
+        double service_ms = 0.0;
+        long mismatches = 0;
+        for (long round = 0; round < rounds; round++) {
+            // Every round is a new session, so each server blinds its set with a fresh r, gets a
+            // challenge from the service and answers it with an EEA proof
+            std::vector<std::vector<G1>> blind_xs(server_count);
+            std::vector<uint64_t> challenge_ids(server_count);
+            std::vector<std::unordered_set<int>> challenges(server_count);
+            std::vector<std::pair<Fr, Fr>> eea_proofs(server_count);
+            std::vector<std::vector<G1>> tis(server_count);
+            for (long s = 0; s < server_count; s++) {
+                H1Cache h1_cache;
+                Fr r = server_blinding(server_sets[s], blind_xs[s], h1_cache); // H1(x)^r
+                challenge_ids[s] = service.issue_challenge(server_sets[s], blind_xs[s], &challenges[s]);
+                tis[s].resize(server_sets[s].size());
+                eea_proofs[s] = generate_eea_proof(server_sets[s], r, challenges[s], tis[s], h1_cache);
+            }
+
+            // Today: one sequential verification and signature per server session
+            std::vector<std::vector<G1>> expected(server_count);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (long s = 0; s < server_count; s++) 
+                if (verify_eea_proof(server_sets[s], challenges[s], eea_proofs[s], blind_xs[s], tis[s])) 
+                    expected[s] = judge_sign(blind_xs[s], judge_sk);
+            auto stop = std::chrono::high_resolution_clock::now();
+            sequential_ms += std::chrono::duration<double, std::milli>(stop - start).count();
+
+            // Service: all servers submit their proofs at once and are verified and signed in shared batches
+            start = std::chrono::high_resolution_clock::now();
+            std::vector<std::future<AuthorizationResult>> results;
+            for (long s = 0; s < server_count; s++) 
+                results.push_back(service.submit(challenge_ids[s], eea_proofs[s], tis[s]));
+            for (long s = 0; s < server_count; s++) {
+                AuthorizationResult result = results[s].get();
+                if (result.signatures.size() != expected[s].size()) 
+                    mismatches++;
+                for (size_t j = 0; j < result.signatures.size() && j < expected[s].size(); j++) 
+                    if (!(result.signatures[j] == expected[s][j])) 
+                        mismatches++;
+            }
+            stop = std::chrono::high_resolution_clock::now();
+            service_ms += std::chrono::duration<double, std::milli>(stop - start).count();
+        }
+
+        JudgeServiceStats stats = service.stats();
+        std::cout << "Requests " << stats.requests << " (" << stats.rejected << " rejected) in " << stats.batches << " batches"
+                  << ", sequential " << sequential_ms << " ms, service " << service_ms << " ms"
+                  << ", p50 " << stats.latencies.percentile(50) << " ms, p99 " << stats.latencies.percentile(99) << " ms"
+                  << ", signature mismatches " << mismatches << std::endl;
+        service_csv << server_count << "," 
+                    << rounds << ","
+                    << set_size_server << ","
+                    << stats.requests << ","
+                    << stats.rejected << ","
+                    << stats.batches << ","
+                    << sequential_ms << ","
+                    << service_ms << ","
+                    << stats.latencies.percentile(50) << ","
+                    << stats.latencies.percentile(90) << ","
+                    << stats.latencies.percentile(99) << "\n";
+    }
+}
+
+void benchmark_curves(long repetitions, long number_of_parties, long set_size_clients, long set_size_server, int p_fraction, 
+                      int false_positive_exponent, std::vector<std::string> curves) {
+    long long domain_size = (1LL << 32) - 1;
+    long forced_intersection_size = set_size_clients / 4;
+    const size_t pairing_samples = 64;
+
+    std::filesystem::create_directory("../data"); 
+    std::ofstream curves_csv("../data/curves.csv");
+    curves_csv << "Curve,Fr Bytes,G1 Bytes,G2 Bytes,GT Bytes,GT Compressed Bytes,Pairing,Client Computation,Leader Client Computation,Server Authorize,Server Intersect,Judge Computation,"
+               << "Client Sent,Leader Client Sent,Server Sent\n";
+
+    for (const std::string& name : curves) {
+        PairingCurve curve;
+        GT base_gt;
+        try {
+            curve = parse_curve(name);
+            base_gt = setup_pairings(curve);
+        } catch (const std::invalid_argument& e) {
+            std::cout << "\nSkipping curve " << name << ": " << e.what() << std::endl;
+            continue;
+        }
+        std::cout << "\nBenchmarking curve " << curve_name(curve) << ", " << number_of_parties << " parties" << std::endl;
+
+        BloomFilterParams params(set_size_clients, false_positive_exponent, base_gt, curve); 
+        mcl::bn::G2 judge_pk;
+        mcl::bn::Fr judge_sk;
+        setup_judge_keys(judge_pk, judge_sk, curve);
+        CurveSizes sizes = curve_sizes();
+
+        // Latency of a single pairing on random points
+        std::vector<G1> ps(pairing_samples);
+        std::vector<G2> qs(pairing_samples);
+        for (size_t i = 0; i < pairing_samples; i++) {
+            Fr r;
+            r.setByCSPRNG();
+            hashAndMapToG1(ps[i], &i, sizeof(i));
+            G2::mul(qs[i], judge_pk, r);
+        }
+        GT e;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < pairing_samples; i++) 
+            pairing(e, ps[i], qs[i]);
+        auto stop = std::chrono::high_resolution_clock::now();
+        double pairing_time = std::chrono::duration<double, std::milli>(stop - start).count() / pairing_samples;
+
+        std::vector<long> client_computation_times;
+        std::vector<long> leader_client_computation_times;
+        std::vector<long> server_authorize_times;
+        std::vector<long> server_intersect_times;
+        std::vector<long> judge_computation_times;
+        std::vector<size_t> client_sent_bytes_all, leader_client_sent_bytes_all, server_sent_bytes_all;
+        for (int i = 0; i < repetitions; ++i) {
+            std::vector<std::vector<long>> client_sets;
+            std::vector<long> server_set;
+            generate_clients_and_server_sets(number_of_parties - 1, set_size_clients, set_size_server, 
+                domain_size, forced_intersection_size, client_sets, server_set);
+
+            double client_computation_time = 0.0;
+            double leader_client_computation_time = 0.0;
+            double server_authorize_time = 0.0;
+            double server_intersect_time = 0.0;
+            double judge_computation_time = 0.0;
+            size_t server_sent_bytes = 0;
+            size_t server_received_bytes = 0;
+            size_t client_sent_bytes = 0;
+            size_t client_received_bytes = 0;
+            size_t leader_client_sent_bytes = 0;
+            size_t leader_client_received_bytes = 0;
+            size_t judge_sent_bytes = 0;
+            size_t judge_received_bytes = 0;
+
+            std::vector<long> result = multiparty_psi(
+                client_sets, 
+                server_set, 
+                params, 
+                judge_pk,
+                judge_sk,
+                p_fraction,
+                &client_computation_time,
+                &leader_client_computation_time,
+                &server_authorize_time,
+                &server_intersect_time,
+                &judge_computation_time,
+                &server_sent_bytes,
+                &server_received_bytes,
+                &client_sent_bytes,
+                &client_received_bytes,
+                &leader_client_sent_bytes,
+                &leader_client_received_bytes,
+                &judge_sent_bytes,
+                &judge_received_bytes
+            );
+
+            std::vector<long> expected = compute_intersection_non_private(client_sets, server_set);
+            std::cout << "Expected size: " << expected.size() << ", MPSI size: " << result.size() << std::endl;
+
+            client_computation_times.push_back(static_cast<long>(client_computation_time));
+            leader_client_computation_times.push_back(static_cast<long>(leader_client_computation_time));
+            server_authorize_times.push_back(static_cast<long>(server_authorize_time));
+            server_intersect_times.push_back(static_cast<long>(server_intersect_time));
+            judge_computation_times.push_back(static_cast<long>(judge_computation_time));
+            client_sent_bytes_all.push_back(client_sent_bytes);
+            leader_client_sent_bytes_all.push_back(leader_client_sent_bytes);
+            server_sent_bytes_all.push_back(server_sent_bytes);
+        }
+
+        std::cout << "GT " << sizes.gt << " bytes (" << sizes.gt_compressed << " compressed), pairing " 
+                  << pairing_time << " ms" << std::endl;
+        curves_csv << curve_name(curve) << ","
+                   << sizes.fr << ","
+                   << sizes.g1 << ","
+                   << sizes.g2 << ","
+                   << sizes.gt << ","
+                   << sizes.gt_compressed << ","
+                   << pairing_time << ","
+                   << sample_mean_computation(client_computation_times) << ","
+                   << sample_mean_computation(leader_client_computation_times) << ","
+                   << sample_mean_computation(server_authorize_times) << ","
+                   << sample_mean_computation(server_intersect_times) << ","
+                   << sample_mean_computation(judge_computation_times) << ","
+                   << sample_mean_communication(client_sent_bytes_all) << ","
+                   << sample_mean_communication(leader_client_sent_bytes_all) << ","
+                   << sample_mean_communication(server_sent_bytes_all) << "\n";
+    }
+
+    setup_pairings(); // back to the default curve for later runs
 }
\ No newline at end of file
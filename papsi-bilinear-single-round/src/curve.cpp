@@ -0,0 +1,49 @@
+#include "curve.hpp"
+#include <stdexcept>
+#include "gt_compression.hpp"
+
+using namespace mcl::bn;
+
+static PairingCurve current_curve = PairingCurve::BN254; // mcl's default
+
+PairingCurve parse_curve(const std::string& name) {
+    if (name == "BN254") 
+        return PairingCurve::BN254;
+    if (name == "BLS12-381" || name == "BLS12_381") 
+        return PairingCurve::BLS12_381;
+    if (name == "BLS12-377" || name == "BLS12_377") 
+        return PairingCurve::BLS12_377;
+    throw std::invalid_argument("Unknown pairing curve " + name + ", expected BN254, BLS12-381 or BLS12-377");
+}
+
+std::string curve_name(PairingCurve curve) {
+    switch (curve) {
+        case PairingCurve::BN254: return "BN254";
+        case PairingCurve::BLS12_381: return "BLS12-381";
+        case PairingCurve::BLS12_377: return "BLS12-377";
+    }
+    return "unknown";
+}
+
+void select_curve(PairingCurve curve) {
+    switch (curve) {
+        case PairingCurve::BN254: 
+            initPairing(mcl::BN254); 
+            break;
+        case PairingCurve::BLS12_381: 
+            initPairing(mcl::BLS12_381); 
+            break;
+        case PairingCurve::BLS12_377: 
+            throw std::invalid_argument("BLS12-377 is not available: mcl only implements BN and BLS12-381 pairings");
+    }
+    current_curve = curve;
+}
+
+PairingCurve selected_curve() {
+    return current_curve;
+}
+
+CurveSizes curve_sizes() {
+    size_t fp = Fp::getByteSize();
+    return {Fr::getByteSize(), fp, 2 * fp, 12 * fp, compressed_gt_size()};
+}
\ No newline at end of file
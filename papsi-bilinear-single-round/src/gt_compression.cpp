@@ -0,0 +1,108 @@
+#include "gt_compression.hpp"
+
+// Montgomery's trick: one Fp6 inversion and three multiplications per value
+static void batch_invert(std::vector<Fp6>& values) {
+    if (values.empty()) 
+        return;
+    std::vector<Fp6> prefix(values.size());
+    prefix[0] = values[0];
+    for (size_t i = 1; i < values.size(); i++) 
+        Fp6::mul(prefix[i], prefix[i - 1], values[i]);
+
+    Fp6 inverse;
+    Fp6::inv(inverse, prefix.back());
+    for (size_t i = values.size() - 1; i > 0; i--) {
+        Fp6 value_inverse;
+        Fp6::mul(value_inverse, inverse, prefix[i - 1]);
+        Fp6::mul(inverse, inverse, values[i]);
+        values[i] = value_inverse;
+    }
+    values[0] = inverse;
+}
+
+static Fp6 fp6_one() {
+    Fp6 one;
+    one.clear();
+    one.a.a = 1;
+    return one;
+}
+
+// v, the square of w
+static Fp6 fp6_gamma() {
+    Fp6 gamma;
+    gamma.clear();
+    gamma.b.a = 1;
+    return gamma;
+}
+
+static Fp* fp6_coefficient(Fp6& x, int i) {
+    Fp2& coefficient = i < 2 ? x.a : (i < 4 ? x.b : x.c);
+    return i % 2 == 0 ? &coefficient.a : &coefficient.b;
+}
+
+size_t compressed_gt_size() {
+    return 6 * Fp::getByteSize();
+}
+
+std::vector<uint8_t> serialize_gts_compressed(const std::vector<GT>& xs) {
+    // c = (1 + a) / b, with all the b's inverted at once
+    std::vector<Fp6> inverses(xs.size());
+    for (size_t i = 0; i < xs.size(); i++) 
+        inverses[i] = xs[i].b.isZero() ? fp6_one() : xs[i].b;
+    batch_invert(inverses);
+
+    size_t fp_size = Fp::getByteSize();
+    std::vector<uint8_t> buffer(xs.size() * compressed_gt_size());
+    Fp6 one = fp6_one();
+    for (size_t i = 0; i < xs.size(); i++) {
+        Fp6 c;
+        if (xs[i].b.isZero()) {
+            c.clear(); // identity
+        } else {
+            Fp6::add(c, one, xs[i].a);
+            Fp6::mul(c, c, inverses[i]);
+        }
+        uint8_t* out = buffer.data() + i * compressed_gt_size();
+        for (int k = 0; k < 6; k++) 
+            fp6_coefficient(c, k)->serialize(out + k * fp_size, fp_size);
+    }
+    return buffer;
+}
+
+bool deserialize_gts_compressed(const std::vector<uint8_t>& buffer, std::vector<GT>& xs) {
+    if (buffer.size() % compressed_gt_size() != 0) 
+        return false;
+    size_t count = buffer.size() / compressed_gt_size();
+    size_t fp_size = Fp::getByteSize();
+
+    std::vector<Fp6> cs(count);
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* in = buffer.data() + i * compressed_gt_size();
+        for (int k = 0; k < 6; k++) {
+            if (fp6_coefficient(cs[i], k)->deserialize(in + k * fp_size, fp_size) == 0) 
+                return false;
+        }
+    }
+
+    // x = (c + w) / (c - w) = ((c^2 + v) + 2c w) / (c^2 - v), with all the denominators inverted at once
+    Fp6 gamma = fp6_gamma();
+    std::vector<Fp6> squares(count), denominators(count);
+    for (size_t i = 0; i < count; i++) {
+        Fp6::sqr(squares[i], cs[i]);
+        Fp6::sub(denominators[i], squares[i], gamma); // never 0, v is not a square in Fp6
+    }
+    batch_invert(denominators);
+
+    xs.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        if (cs[i].isZero()) {
+            xs[i] = 1; // identity
+            continue;
+        }
+        Fp6::add(xs[i].a, squares[i], gamma);
+        Fp6::mul(xs[i].a, xs[i].a, denominators[i]);
+        Fp6::add(xs[i].b, cs[i], cs[i]);
+        Fp6::mul(xs[i].b, xs[i].b, denominators[i]);
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef HASH_TO_CURVE_HPP
+#define HASH_TO_CURVE_HPP
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include <mcl/bn.hpp>
+
+using namespace mcl::bn;
+
+// H1(x): hash-to-G1 of a domain tag followed by the 8-byte little-endian element
+void hash_to_G1(G1& h, long element);
+G1 hash_to_G1(long element);
+std::vector<G1> hash_to_G1_batch(const std::vector<long>& elements, size_t thread_count = 0);
+
+// H2: G1 -> G1 over a domain tag followed by the compressed binary serialization of the point
+void h2(G1& h, const G1& point);
+G1 h2(const G1& point);
+
+// Per-session memo of H1(x), so that a party maps each element to the curve at most once
+struct H1Cache {
+    std::unordered_map<long, G1> points;
+    size_t thread_count; // 0 = one thread per core
+
+    explicit H1Cache(size_t thread_count = 0);
+
+    void insert_batch(const std::vector<long>& elements); // hashes the missing elements in parallel
+    const G1& get(long element); // hashes on a miss
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "judge_service.hpp"
+#include <cmath>
+#include <algorithm>
+#include "mpsi_protocol.hpp"
+
+LatencyHistogram::LatencyHistogram(double bucket_ms, size_t bucket_count) 
+    : bucket_ms(bucket_ms), counts(std::max<size_t>(bucket_count, 1), 0) {}
+
+void LatencyHistogram::record(double latency_ms) {
+    size_t bucket = static_cast<size_t>(latency_ms / bucket_ms);
+    counts[std::min(bucket, counts.size() - 1)]++;
+    total++;
+}
+
+double LatencyHistogram::percentile(double percentile) const {
+    if (total == 0) 
+        return 0.0;
+    size_t rank = std::max<size_t>(static_cast<size_t>(std::ceil(percentile / 100.0 * total)), 1);
+    size_t seen = 0;
+    for (size_t b = 0; b < counts.size(); b++) {
+        seen += counts[b];
+        if (seen >= rank) 
+            return (b + 1) * bucket_ms;
+    }
+    return counts.size() * bucket_ms;
+}
+
+JudgeService::JudgeService(const Fr& judge_sk, const JudgeServiceConfig& config)
+    : judge_sk(judge_sk), config(config), 
+      latencies(config.histogram_bucket_ms, config.histogram_buckets) {
+    dispatcher = std::thread(&JudgeService::dispatcher_loop, this);
+}
+
+JudgeService::~JudgeService() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        stopping = true;
+    }
+    request_available.notify_all();
+    dispatcher.join();
+}
+
+uint64_t JudgeService::issue_challenge(const std::vector<long>& server_set, const std::vector<G1>& blind_xs, 
+                                       std::unordered_set<int>* challenge) {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    *challenge = judge_challenge(server_set, config.challenge_percent);
+    uint64_t challenge_id = next_challenge_id++;
+    pending_challenges.emplace(challenge_id, Challenge{server_set, blind_xs, *challenge});
+    while (pending_challenges.size() > std::max<size_t>(config.max_pending_challenges, 1)) 
+        pending_challenges.erase(pending_challenges.begin());
+    return challenge_id;
+}
+
+std::future<AuthorizationResult> JudgeService::submit(uint64_t challenge_id, const std::pair<Fr, Fr>& eea_proof, 
+                                                      const std::vector<G1>& tis) {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    Request request{false, Challenge(), eea_proof, tis, Clock::now(), std::promise<AuthorizationResult>()};
+    auto pending = pending_challenges.find(challenge_id);
+    if (pending != pending_challenges.end()) {
+        request.issued = true;
+        request.challenge = std::move(pending->second);
+        pending_challenges.erase(pending);
+    }
+    queue.push_back(std::move(request));
+    std::future<AuthorizationResult> result = queue.back().result.get_future();
+    request_available.notify_one();
+    return result;
+}
+
+std::vector<G1> JudgeService::authorize(uint64_t challenge_id, const std::pair<Fr, Fr>& eea_proof, 
+                                        const std::vector<G1>& tis) {
+    return submit(challenge_id, eea_proof, tis).get().signatures;
+}
+
+JudgeServiceStats JudgeService::stats() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return {requests, rejected, batches, latencies};
+}
+
+void JudgeService::dispatcher_loop() {
+    while (true) {
+        std::vector<Request> batch;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            request_available.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) 
+                return;
+            // Give other servers a short window to join the batch
+            auto window = std::chrono::duration<double, std::milli>(config.batch_window_ms);
+            request_available.wait_for(lock, window, [&] { 
+                return stopping || queue.size() >= config.max_batch_requests; 
+            });
+            while (!queue.empty() && batch.size() < std::max<size_t>(config.max_batch_requests, 1)) {
+                batch.push_back(std::move(queue.front()));
+                queue.pop_front();
+            }
+        }
+        serve_batch(batch);
+    }
+}
+
+// Verifies every request's EEA proof, then signs the blinded elements of the requests that
+// passed in one parallel run
+void JudgeService::serve_batch(std::vector<Request>& batch) {
+    std::vector<bool> authorized(batch.size());
+    std::vector<G1> items;
+    for (size_t k = 0; k < batch.size(); k++) {
+        const Request& request = batch[k];
+        const Challenge& challenge = request.challenge;
+        authorized[k] = request.issued && 
+                        challenge.blind_xs.size() == challenge.server_set.size() && 
+                        request.tis.size() == challenge.server_set.size() && 
+                        verify_eea_proof(challenge.server_set, challenge.indices, request.eea_proof, 
+                                         challenge.blind_xs, request.tis);
+        if (authorized[k]) 
+            items.insert(items.end(), challenge.blind_xs.begin(), challenge.blind_xs.end());
+    }
+
+    std::vector<G1> signatures;
+    if (!items.empty()) 
+        signatures = judge_sign(items, judge_sk);
+
+    size_t offset = 0;
+    size_t batch_rejected = 0;
+    std::vector<double> batch_latencies;
+    for (size_t k = 0; k < batch.size(); k++) {
+        Request& request = batch[k];
+        AuthorizationResult result;
+        result.authorized = authorized[k];
+        if (authorized[k]) {
+            size_t count = request.challenge.blind_xs.size();
+            result.signatures.assign(signatures.begin() + offset, signatures.begin() + offset + count);
+            offset += count;
+        } else {
+            batch_rejected++;
+        }
+        result.latency_ms = std::chrono::duration<double, std::milli>(Clock::now() - request.submitted).count();
+        batch_latencies.push_back(result.latency_ms);
+        request.result.set_value(std::move(result));
+    }
+
+    std::lock_guard<std::mutex> stats_lock(queue_mutex);
+    requests += batch.size();
+    rejected += batch_rejected;
+    batches++;
+    for (double latency_ms : batch_latencies) 
+        latencies.record(latency_ms);
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include "pairing_engine.hpp"
+#include "parallel.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+PairingEngine::PairingEngine(const G2& q, size_t thread_count) {
+    precomputeG2(this->q_coeffs, q);
+    this->thread_count = thread_count;
+}
+
+void PairingEngine::pair(GT& e, const G1& p) const {
+    GT f;
+    precomputedMillerLoop(f, p, q_coeffs);
+    finalExp(e, f);
+}
+
+std::vector<GT> PairingEngine::pair_batch(const std::vector<G1>& ps) const {
+    std::vector<GT> results(ps.size());
+    parallel_for(ps.size(), thread_count, [&](size_t i) {
+        pair(results[i], ps[i]);
+    });
+    return results;
+}
+
+const PairingEngine& cached_pairing_engine(const G2& q) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::unique_ptr<PairingEngine>> engines;
+
+    std::string key = q.serializeToHexStr();
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<PairingEngine>& engine = engines[key];
+    if (!engine) 
+        engine = std::make_unique<PairingEngine>(q);
+    return *engine;
+}
\ No newline at end of file